@@ -0,0 +1,104 @@
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Account.hpp"
+#include "Amount.hpp"
+#include "Coin.hpp"
+#include "File.hpp"
+#include "Transaction.hpp"
+#include "bench_util.hpp"
+
+// Times the duplicate check of re-importing an exchange export whose rows are
+// all in the file already, e.g. importing the same Binance CSV twice. The
+// rows are merged into transactions by their import id like the Binance
+// importer does, and every row is looked up the same way: first the
+// transaction by its import id, then the split id with HasSplitImportId
+// within that transaction. Transactions with up to 64 splits are scanned and
+// larger ones use the import id index, so the benchmark is run for several
+// numbers of rows per transaction.
+//
+// usage: bench_import_duplicates [num_rows]
+
+namespace {
+
+struct Row {
+  std::string txn_id;
+  std::string split_id;
+};
+
+// make a file with num_rows rows in transactions of rows_per_txn rows each
+std::vector<Row> MakeLedger(File* file, size_t num_rows, size_t rows_per_txn) {
+  auto assets = file->GetAccount("Assets");
+  auto exchanges = Account::Create(file, "Exchanges", false, assets, false);
+  auto binance = Account::Create(file, "Binance", false, exchanges, false);
+  auto bnb = Coin::Create(file, "binancecoin", "Binance Coin", "BNB", 1839);
+
+  std::vector<Row> rows;
+  rows.reserve(num_rows);
+  time_t time = 1600000000;
+
+  while (rows.size() < num_rows) {
+    auto date = Datetime::FromUNIXTimestamp(time);
+    std::string txn_id = "Binance_" + date.ToStrUTC();
+    time += 60;
+
+    std::vector<ProtoSplit> splits;
+    for (size_t i = 0; (i < rows_per_txn) && (rows.size() < num_rows); ++i) {
+      std::string split_id = txn_id + "_Spot_Buy_BNB_" + std::to_string(i);
+      splits.push_back(
+          ProtoSplit(binance, "", ToAmount(0.5 + i), bnb, split_id));
+      rows.push_back({txn_id, split_id});
+    }
+
+    Transaction::Create(file, date, "Binance Spot trade", splits, txn_id);
+  }
+
+  return rows;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t num_rows = (argc > 1) ? atol(argv[1]) : 500000;
+
+  printf("%lu duplicate rows\n", num_rows);
+  printf("%14s  %22s  %20s\n", "rows per txn", "find transaction (s)",
+      "HasSplitImportId (s)");
+
+  // 64 is the largest transaction that is scanned instead of hashed
+  for (size_t rows_per_txn : {1, 10, 64, 65, 500, 5000}) {
+    auto file = File::InitNewFile(false);
+    auto rows = MakeLedger(&file, num_rows, rows_per_txn);
+
+    // look up the transactions first, so that the import id check is timed
+    // on its own
+    std::vector<std::shared_ptr<const Transaction>> txns(rows.size());
+    auto start = Clock::now();
+    for (size_t r = 0; r < rows.size(); ++r)
+      txns[r] = file.GetTransactionFromImportId(rows[r].txn_id);
+    auto find_time = Clock::now() - start;
+
+    size_t num_duplicates = 0;
+    start = Clock::now();
+    for (size_t r = 0; r < rows.size(); ++r) {
+      if ((txns[r] != nullptr) &&
+          file.HasSplitImportId(rows[r].split_id, txns[r]))
+        ++num_duplicates;
+    }
+    auto check_time = Clock::now() - start;
+
+    if (num_duplicates != rows.size()) {
+      printf("ERROR: only %lu of the %lu rows were found\n", num_duplicates,
+          rows.size());
+      return 1;
+    }
+
+    printf("%14lu  %22.3f  %20.3f\n", rows_per_txn, Seconds(find_time),
+        Seconds(check_time));
+  }
+
+  return 0;
+}
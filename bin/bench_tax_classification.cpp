@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Account.hpp"
+#include "Amount.hpp"
+#include "Coin.hpp"
+#include "File.hpp"
+#include "Transaction.hpp"
+#include "bench_util.hpp"
+#include "prices/DailyData.hpp"
+#include "taxes/Taxes.hpp"
+
+// Times the classification of the splits into tax events, i.e. the Taxes
+// constructor, on a made up ledger with mining and other income, trades for
+// USD and for other coins, trading and transaction fees, spending and
+// transfers between the exchange and a wallet. The coins get random walk daily
+// prices, so nothing is fetched. The defaults are 1,000,000 transactions in 20
+// coins.
+//
+// usage: bench_tax_classification [num_transactions] [num_coins] [seed]
+
+namespace {
+
+struct Accounts {
+  std::shared_ptr<Account> assets, wallets, ecr20, exchanges, equity, expenses,
+      mining_fees, trading_fees, txn_fees, food, income_other, income_mining,
+      income_trade;
+};
+
+Accounts MakeAccounts(File* file) {
+  Accounts a;
+  a.assets = file->GetAccount("Assets");
+  a.wallets = Account::Create(file, "Wallets", false, a.assets, false);
+  a.ecr20 = Account::Create(file, "ECR20", false, a.assets, false);
+  a.exchanges = Account::Create(file, "Exchanges", false, a.assets, false);
+  a.equity = file->GetAccount("Equity");
+  a.expenses = file->GetAccount("Expenses");
+  a.mining_fees =
+      Account::Create(file, "Mining Fees", false, a.expenses, false);
+  a.trading_fees =
+      Account::Create(file, "Trading Fees", false, a.expenses, false);
+  a.txn_fees =
+      Account::Create(file, "Transaction Fees", false, a.expenses, false);
+  a.food = Account::Create(file, "Food", false, a.expenses, false);
+
+  auto income = file->GetAccount("Income");
+  a.income_other = Account::Create(file, "Other", false, income, false);
+  a.income_mining = Account::Create(file, "Mining", false, income, false);
+  a.income_trade = Account::Create(file, "Trade", false, income, false);
+  return a;
+}
+
+// create the coins with daily prices from day start_day to start_day + num_days
+std::vector<std::shared_ptr<const Coin>> MakeCoins(File* file, int num_coins,
+    int64_t start_day, int64_t num_days, std::mt19937_64* rng) {
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::vector<std::shared_ptr<const Coin>> coins;
+
+  for (int c = 0; c < num_coins; ++c) {
+    auto coin = Coin::Create(file, "coin" + std::to_string(c),
+        "Coin " + std::to_string(c), "C" + std::to_string(c), 100 + c);
+    coins.push_back(coin);
+
+    std::vector<Amount> prices;
+    double price = 10.0 + 100.0 * c;
+    for (int64_t d = 0; d < num_days; ++d) {
+      price *= exp(0.05 * (uniform(*rng) - 0.5));
+      prices.push_back(ToAmount(price));
+    }
+    file->SetDailyData(DailyData(coin, start_day, prices));
+  }
+
+  return coins;
+}
+
+// add num_txns transactions in chronological order, the holdings of each coin
+// in the wallet and on the exchange are tracked so that nothing is disposed
+// that has not been acquired
+void MakeLedger(File* file, const Accounts& a,
+    const std::vector<std::shared_ptr<const Coin>>& coins, size_t num_txns,
+    int64_t start_day, int64_t num_days, std::mt19937_64* rng) {
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  auto U = [&]() { return uniform(*rng); };
+
+  auto usd = file->GetCoin(Coin::USD_id());
+  int num_coins = coins.size();
+  std::vector<double> exchange(num_coins, 0.0), wallet(num_coins, 0.0);
+  double span = (num_days - 2) * 86400.0;
+
+  // a transaction that would dispose more than there is, is drawn again
+  size_t i = 0;
+  while (i < num_txns) {
+    auto date = Datetime::FromUNIXTimestamp(
+        start_day * 86400 + static_cast<time_t>(span * i / num_txns));
+    int c = (*rng)() % num_coins;
+    auto coin = coins[c];
+    double r = U();
+    std::vector<ProtoSplit> splits;
+
+    if (r < 0.2) {
+      // mining or other income to the wallet
+      Amount x = ToAmount(0.01 + U());
+      auto income = (r < 0.15) ? a.income_mining : a.income_other;
+      splits.push_back(ProtoSplit(income, "", -x, coin, ""));
+      splits.push_back(ProtoSplit(a.wallets, "", x, coin, ""));
+      wallet[c] += x.ToDouble();
+    } else if (r < 0.5) {
+      // buy with USD on the exchange, the fee is paid in USD
+      Amount x = ToAmount(0.01 + U());
+      Amount usd_amount = ToAmount(5.0 + 100.0 * U());
+      Amount fee = ToAmount(0.1 + U());
+      Amount paid = usd_amount + fee;
+      splits.push_back(ProtoSplit(a.exchanges, "", -paid, usd, ""));
+      splits.push_back(ProtoSplit(a.exchanges, "", x, coin, ""));
+      splits.push_back(ProtoSplit(a.trading_fees, "", fee, usd, ""));
+      exchange[c] += x.ToDouble();
+    } else if (r < 0.75) {
+      // sell for USD or for another coin on the exchange
+      if (exchange[c] < 0.001) continue;
+      Amount x = ToAmount(std::max(0.000001, exchange[c] * U()));
+      splits.push_back(ProtoSplit(a.exchanges, "", -x, coin, ""));
+      if ((U() < 0.7) || (num_coins < 2)) {
+        Amount usd_amount = ToAmount(x.ToDouble() * 50.0 * (0.5 + U()));
+        splits.push_back(ProtoSplit(a.exchanges, "", usd_amount, usd, ""));
+      } else {
+        int c2 = (c + 1 + (*rng)() % (num_coins - 1)) % num_coins;
+        Amount y = ToAmount(0.001 + U());
+        splits.push_back(ProtoSplit(a.exchanges, "", y, coins[c2], ""));
+        exchange[c2] += y.ToDouble();
+      }
+      exchange[c] -= x.ToDouble();
+    } else if (r < 0.85) {
+      // spend from the wallet
+      if (wallet[c] < 0.001) continue;
+      Amount x = ToAmount(std::max(0.000001, wallet[c] * 0.3 * U()));
+      splits.push_back(ProtoSplit(a.wallets, "", -x, coin, ""));
+      splits.push_back(ProtoSplit(a.food, "", x, coin, ""));
+      wallet[c] -= x.ToDouble();
+    } else if ((r < 0.9) || (num_coins < 3)) {
+      // move from the exchange to the wallet, paying a transaction fee
+      Amount x = ToAmount(exchange[c] * 0.5 * U());
+      Amount fee = ToAmount(0.0001);
+      if (x < ToAmount(0.0002)) continue;
+      splits.push_back(ProtoSplit(a.exchanges, "", -(x + fee), coin, ""));
+      splits.push_back(ProtoSplit(a.wallets, "", x, coin, ""));
+      splits.push_back(ProtoSplit(a.txn_fees, "", fee, coin, ""));
+      exchange[c] -= (x + fee).ToDouble();
+      wallet[c] += x.ToDouble();
+    } else if (r < 0.93) {
+      // trade income on the exchange
+      Amount x = ToAmount(0.01 + U());
+      splits.push_back(ProtoSplit(a.income_trade, "", -x, coin, ""));
+      splits.push_back(ProtoSplit(a.exchanges, "", x, coin, ""));
+      exchange[c] += x.ToDouble();
+    } else if (r < 0.96) {
+      // spend from the wallet for a price in USD
+      if (wallet[c] < 0.001) continue;
+      Amount x = ToAmount(std::max(0.000001, wallet[c] * 0.3 * U()));
+      Amount usd_amount = ToAmount(x.ToDouble() * 40.0);
+      splits.push_back(ProtoSplit(a.wallets, "", -x, coin, ""));
+      splits.push_back(ProtoSplit(a.food, "", usd_amount, usd, ""));
+      wallet[c] -= x.ToDouble();
+    } else {
+      // trade for another coin with the fee paid in a third coin
+      int c2 = (c + 1) % num_coins;
+      int c3 = (c + 2) % num_coins;
+      Amount fee = ToAmount(0.0001);
+      if ((exchange[c] < 0.001) || (exchange[c3] < 0.001)) continue;
+      Amount x = ToAmount(exchange[c] * U());
+      Amount y = ToAmount(0.001 + U());
+      if (x <= 0) continue;
+      splits.push_back(ProtoSplit(a.exchanges, "", -x, coin, ""));
+      splits.push_back(ProtoSplit(a.exchanges, "", y, coins[c2], ""));
+      splits.push_back(ProtoSplit(a.trading_fees, "", fee, coins[c3], ""));
+      splits.push_back(ProtoSplit(a.exchanges, "", -fee, coins[c3], ""));
+      exchange[c] -= x.ToDouble();
+      exchange[c2] += y.ToDouble();
+      exchange[c3] -= fee.ToDouble();
+    }
+
+    Transaction::Create(file, date, "txn " + std::to_string(i), splits,
+        "bench_" + std::to_string(i));
+    ++i;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t num_txns = (argc > 1) ? atol(argv[1]) : 1000000;
+  int num_coins = (argc > 2) ? atoi(argv[2]) : 20;
+  unsigned seed = (argc > 3) ? atol(argv[3]) : 42;
+
+  const int64_t start_day = 17000;
+  const int64_t num_days = 1500;
+
+  auto start = Clock::now();
+  std::mt19937_64 rng(seed);
+  auto file = File::InitNewFile(false);
+  auto a = MakeAccounts(&file);
+  auto coins = MakeCoins(&file, num_coins, start_day, num_days, &rng);
+  MakeLedger(&file, a, coins, num_txns, start_day, num_days, &rng);
+  printf("made %lu transactions in %i coins in %.3f s\n",
+      file.Transactions().size(), num_coins, Seconds(Clock::now() - start));
+
+  // one thread, so the times are comparable between machines
+  start = Clock::now();
+  Taxes taxes(file, Datetime::FromUNIXTimestamp((start_day + num_days) * 86400),
+      a.assets, a.wallets, a.ecr20, a.exchanges, a.equity, a.expenses,
+      a.mining_fees, a.trading_fees, a.txn_fees, a.income_other,
+      a.income_mining, a.income_trade, {}, 1);
+  printf("classified in %.3f s\n", Seconds(Clock::now() - start));
+
+  return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef BIN_BENCH_UTIL_HPP_
+#define BIN_BENCH_UTIL_HPP_
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#include "Amount.hpp"
+
+// helpers shared by the benchmark programs
+
+using Clock = std::chrono::steady_clock;
+
+// round to micro units, like amounts imported from an exchange, this is much
+// faster than Amount::Parse for the millions of made up amounts
+inline Amount ToAmount(double x) {
+  return Amount(static_cast<int64_t>(std::llround(x * 1.0e6)), -6);
+}
+
+inline double Seconds(Clock::duration d) {
+  return std::chrono::duration<double>(d).count();
+}
+
+#endif  // BIN_BENCH_UTIL_HPP_
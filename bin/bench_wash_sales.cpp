@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Amount.hpp"
+#include "File.hpp"
+#include "bench_util.hpp"
+#include "taxes/Inventory.hpp"
+#include "taxes/Taxes.hpp"
+#include "taxes/WashSales.hpp"
+
+// Times the wash sale detection on a made up stream of events of one coin that
+// is bought and sold every few minutes at a random walk price, so most
+// dispositions have a loss or an acquisition within 30 days. The lots are
+// matched LIFO the same way Taxes matches them. The defaults give 103,631
+// dispositions.
+//
+// usage: bench_wash_sales [num_events] [seed]
+
+int main(int argc, char** argv) {
+  size_t num_events = (argc > 1) ? atol(argv[1]) : 200000;
+  unsigned seed = (argc > 2) ? atol(argv[2]) : 11;
+
+  // the coin is only needed to create the gains, no prices are fetched
+  auto file = File::InitNewFile(false);
+  std::shared_ptr<const Coin> coin =
+      Coin::Create(&file, "bench-coin", "Bench Coin", "BENCH", 0);
+
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  std::vector<GainLoss> gains;
+  WashSales wash_sales(&gains);
+  Inventory inventory(LotMethod::LIFO);
+
+  double price = 100.0;
+  double holding = 0.0;
+  time_t time = 17000 * 86400;
+  size_t num_disposals = 0;
+  Amount disallowed(0);
+  Clock::duration wash_time(0);
+
+  auto start = Clock::now();
+  for (size_t i = 0; i < num_events; ++i) {
+    time += 1 + static_cast<time_t>(uniform(rng) * 3600.0);
+    price *= exp(0.04 * (uniform(rng) - 0.5));
+    auto date = Datetime::FromUNIXTimestamp(time);
+    double r = uniform(rng);
+
+    // acquisitions are buys and mining income (which one does not matter
+    // here), a trading fee paid in the coin is a negative acquisition
+    Amount acquired(0);
+    if ((r < 0.45) || (holding < 0.01)) {
+      acquired = ToAmount(0.01 + uniform(rng));
+      uniform(rng);
+    } else if ((r < 0.47) && (holding > 0.1)) {
+      acquired = -ToAmount(0.001 * uniform(rng) + 0.000001);
+    }
+
+    if (acquired != 0) {
+      Amount cost = acquired * ToAmount(price);
+
+      auto wash_start = Clock::now();
+      Amount wash_sale = wash_sales.Acquire(date, acquired);
+      wash_time += Clock::now() - wash_start;
+
+      disallowed += wash_sale;
+      inventory.Acquire(InventoryItem(date, acquired, cost + wash_sale));
+      holding += acquired.ToDouble();
+      continue;
+    }
+
+    // the rest are sales and spending
+    Amount amount =
+        ToAmount(std::max(0.000001, (holding - 0.002) * uniform(rng)));
+    Amount proceeds = amount * ToAmount(price);
+    uniform(rng);
+
+    auto disp = inventory.Dispose(amount);
+    for (auto& d : disp) {
+      Amount this_proceed =
+          (disp.size() == 1) ? proceeds : (proceeds * d.amount) / amount;
+      gains.push_back(GainLoss(
+          coin, d.amount, d.date, date, this_proceed, d.cost_in_usd));
+    }
+    holding -= amount.ToDouble();
+    ++num_disposals;
+  }
+  auto total_time = Clock::now() - start;
+
+  size_t num_washed = 0;
+  for (auto& g : gains) {
+    if (g.wash_sale_loss > 0) ++num_washed;
+  }
+
+  printf("%lu events, %lu dispositions, %lu gains, %lu washed\n", num_events,
+      num_disposals, gains.size(), num_washed);
+  printf("disallowed loss: %s USD\n", disallowed.ToStr().c_str());
+  printf("WashSales::Acquire: %.3f s, total: %.3f s\n", Seconds(wash_time),
+      Seconds(total_time));
+
+  return 0;
+}
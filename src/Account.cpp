@@ -14,10 +14,9 @@ std::shared_ptr<Account> Account::Create(File* file, std::string name,
     bool placeholder, std::shared_ptr<Account> parent, bool single_coin,
     std::shared_ptr<const Coin> coin) {
   // check if an account with this full name already exists
-  auto full_name = MakeFullName(parent, name);
-
-  if (file->AccountsByFullname().count(full_name) > 0) {
-    printf("WARNING account '%s' already exists\n", full_name.c_str());
+  if (file->GetAccount(parent, name) != nullptr) {
+    printf("WARNING account '%s' already exists\n",
+        MakeFullName(parent, name).c_str());
     return nullptr;
   } else {
     auto id = uuid_t::Random();
@@ -39,6 +38,27 @@ std::string Account::MakeFullName(
   }
 }
 
+void Account::AddChild(std::shared_ptr<const Account> child) {
+  auto pos = std::upper_bound(children_.begin(), children_.end(), child,
+      [](std::shared_ptr<const Account> a, std::shared_ptr<const Account> b) {
+        return a->name_ < b->name_;
+      });
+  children_.insert(pos, child);
+}
+
+void Account::RemoveChild(std::shared_ptr<const Account> child) {
+  children_.erase(std::remove_if(children_.begin(), children_.end(),
+                      [&](std::shared_ptr<const Account> c) {
+                        return c->Id() == child->Id();
+                      }),
+      children_.end());
+}
+
+void Account::InvalidateFullName() const {
+  full_name_.clear();
+  for (auto c : children_) c->InvalidateFullName();
+}
+
 bool Account::IsContainedIn(std::shared_ptr<const Account> parent) const {
   if (parent->Id() == id_) return true;
   if (parent_ != nullptr)
@@ -50,37 +70,5 @@ bool Account::IsContainedIn(std::shared_ptr<const Account> parent) const {
 void Account::PrintTree(std::string indent) const {
   printf("%s%s\n", indent.c_str(), name_.c_str());
 
-  // sort children by name
-  std::sort(children_.begin(), children_.end(),
-      [](std::shared_ptr<const Account> a, std::shared_ptr<const Account> b) {
-        return a->name_ < b->name_;
-      });
-
   for (auto c : children_) c->PrintTree(indent + "  ");
 }
-
-Balance Account::PrintTreeBalance(const UUIDMap<Balance>& balances,
-    std::string indent, bool flip_sign,
-    const std::unordered_map<std::string, Amount>* prices) const {
-  printf("%s%s\n", indent.c_str(), name_.c_str());
-  balances.at(id_).Print(indent + "    ", flip_sign, prices);
-
-  // sort children by name
-  std::sort(children_.begin(), children_.end(),
-      [](std::shared_ptr<const Account> a, std::shared_ptr<const Account> b) {
-        return a->name_ < b->name_;
-      });
-
-  if (children_.size() > 0) {
-    Balance sum = balances.at(id_);
-    for (auto c : children_)
-      sum += c->PrintTreeBalance(balances, indent + "  ", flip_sign, prices);
-
-    printf("%sTOTAL %s\n", indent.c_str(), name_.c_str());
-    sum.Print(indent + "    ", flip_sign, prices);
-
-    return sum;
-  } else {
-    return balances.at(id_);
-  }
-}
@@ -32,20 +32,28 @@ class Account {
   bool SingleCoin() const { return single_coin_; }
   std::shared_ptr<const Coin> GetCoin() const { return coin_; }
 
+  // child accounts sorted by name
+  const std::vector<std::shared_ptr<const Account>>& Children() const {
+    return children_;
+  }
+
+  // dense index of this account in the file, used to address per-account data
+  size_t Index() const { return index_; }
+
   static std::string MakeFullName(
       std::shared_ptr<const Account> parent, std::string name);
-  std::string FullName() const { return MakeFullName(parent_, name_); }
+
+  // the full name is cached and only rebuilt after this account or one of its
+  // ancestors has been renamed or moved
+  const std::string& FullName() const {
+    if (full_name_.empty()) full_name_ = MakeFullName(parent_, name_);
+    return full_name_;
+  }
 
   bool IsContainedIn(std::shared_ptr<const Account> parent) const;
 
   void PrintTree(std::string indent = "") const;
 
-  // print the balance of this account, all the sub account balance trees, and
-  // then print the total balance in this account and return the total balance
-  Balance PrintTreeBalance(const UUIDMap<Balance>& balances, std::string indent,
-      bool flip_sign,
-      const std::unordered_map<std::string, Amount>* prices) const;
-
  private:
   friend class File;
 
@@ -57,17 +65,28 @@ class Account {
         placeholder_(placeholder),
         parent_(parent),
         single_coin_(single_coin),
-        coin_(coin) {}
+        coin_(coin),
+        index_(0) {}
 
   void SetParent(std::shared_ptr<Account> parent) {
     parent_ = parent;
+    InvalidateFullName();
     // parent->AddChild(this);
   }
 
-  void AddChild(std::shared_ptr<const Account> child) {
-    children_.push_back(child);
+  void SetName(std::string name) {
+    name_ = name;
+    InvalidateFullName();
   }
 
+  // insert the child so that the children stay sorted by name
+  void AddChild(std::shared_ptr<const Account> child);
+
+  void RemoveChild(std::shared_ptr<const Account> child);
+
+  // clear the cached full name of this account and all its descendants
+  void InvalidateFullName() const;
+
   // unique global identifier of this account
   const uuid_t id_;
 
@@ -88,8 +107,14 @@ class Account {
   // if this is a single coin account, this is the coin used in this account
   std::shared_ptr<const Coin> coin_;
 
-  // child accounts whose parent account is this account
-  mutable std::vector<std::shared_ptr<const Account>> children_;
+  // dense index assigned by the file
+  size_t index_;
+
+  // child accounts whose parent account is this account, sorted by name
+  std::vector<std::shared_ptr<const Account>> children_;
+
+  // cached full name, empty if it needs to be rebuilt
+  mutable std::string full_name_;
 };
 
 #endif  // SRC_ACCOUNT_HPP_
@@ -0,0 +1,102 @@
+/// \file AccountTrie.cpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#include "AccountTrie.hpp"
+
+#include <boost/utility/string_view.hpp>
+
+void AccountTrie::Attach(std::shared_ptr<Account> account) {
+  size_t parent = ParentNode(account);
+  if (nodes_[parent].children.count(account->Name()) > 0)
+    throw std::invalid_argument(
+        "Account '" + account->FullName() + "' already exists");
+
+  size_t idx;
+  if (node_by_id_.count(account->Id()) > 0) {
+    idx = node_by_id_.at(account->Id());
+  } else {
+    idx = nodes_.size();
+    nodes_.push_back(Node());
+    nodes_[idx].account = account;
+    node_by_id_.insert({{account->Id(), idx}});
+  }
+
+  nodes_[parent].children.insert({{account->Name(), idx}});
+}
+
+void AccountTrie::Detach(std::shared_ptr<const Account> account) {
+  auto& siblings = nodes_[ParentNode(account)].children;
+  auto it = siblings.find(account->Name());
+  if ((it != siblings.end()) && (it->second == node_by_id_.at(account->Id())))
+    siblings.erase(it);
+}
+
+std::shared_ptr<Account> AccountTrie::Find(const std::string& full_name) const {
+  return nodes_[FindNode(full_name)].account;
+}
+
+std::shared_ptr<Account> AccountTrie::FindChild(
+    std::shared_ptr<const Account> parent, const std::string& name) const {
+  size_t idx = 0;
+  if (parent != nullptr) {
+    auto it = node_by_id_.find(parent->Id());
+    if (it == node_by_id_.end()) return nullptr;
+    idx = it->second;
+  }
+
+  auto& children = nodes_[idx].children;
+  auto it = children.find(name);
+  return it == children.end() ? nullptr : nodes_[it->second].account;
+}
+
+std::vector<std::shared_ptr<Account>> AccountTrie::TopLevel() const {
+  std::vector<std::shared_ptr<Account>> res;
+  for (auto& c : nodes_[0].children) res.push_back(nodes_[c.second].account);
+  return res;
+}
+
+std::vector<std::shared_ptr<Account>> AccountTrie::Subtree(
+    const std::string& full_name) const {
+  std::vector<std::shared_ptr<Account>> res;
+  size_t start = FindNode(full_name);
+  if (start == 0) return res;
+
+  // children are visited in name order since they are stored in a std::map,
+  // push them in reverse so that the first child is popped first
+  std::vector<size_t> stack{start};
+  while (stack.size() > 0) {
+    auto& node = nodes_[stack.back()];
+    stack.pop_back();
+    res.push_back(node.account);
+    for (auto it = node.children.rbegin(); it != node.children.rend(); ++it)
+      stack.push_back(it->second);
+  }
+
+  return res;
+}
+
+size_t AccountTrie::FindNode(const std::string& full_name) const {
+  boost::string_view rest(full_name);
+  size_t idx = 0;
+
+  while (true) {
+    auto sep = rest.find("::");
+    auto& children = nodes_[idx].children;
+    auto it = children.find(rest.substr(0, sep));
+    if (it == children.end()) return 0;
+    idx = it->second;
+
+    if (sep == boost::string_view::npos) return idx;
+    rest = rest.substr(sep + 2);
+  }
+}
+
+size_t AccountTrie::ParentNode(std::shared_ptr<const Account> account) const {
+  if (account->Parent() == nullptr) return 0;
+  return node_by_id_.at(account->Parent()->Id());
+}
@@ -0,0 +1,75 @@
+/// \file AccountTrie.hpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#ifndef SRC_ACCOUNTTRIE_HPP_
+#define SRC_ACCOUNTTRIE_HPP_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Account.hpp"
+#include "UUID.hpp"
+
+// A trie over the components of the full account names
+// (parent::parent::account). Every node except the root corresponds to one
+// account, so looking up an account by its full name or listing all the
+// accounts under a given account only walks the name components and never has
+// to assemble full names.
+
+class AccountTrie {
+ public:
+  AccountTrie() : nodes_(1) {}
+
+  // attach the account to the node of its parent, the parent must already be
+  // attached
+  void Attach(std::shared_ptr<Account> account);
+
+  // detach the account (and with it its whole subtree) from the node of its
+  // current parent, the subtree is kept so that it can be attached again after
+  // the account has been renamed or moved
+  void Detach(std::shared_ptr<const Account> account);
+
+  // return the account with the given full name or nullptr if there is no such
+  // account
+  std::shared_ptr<Account> Find(const std::string& full_name) const;
+
+  // return the child of parent (or the root account if parent is nullptr) with
+  // the given name or nullptr if there is no such account
+  std::shared_ptr<Account> FindChild(
+      std::shared_ptr<const Account> parent, const std::string& name) const;
+
+  // return the accounts without a parent sorted by name
+  std::vector<std::shared_ptr<Account>> TopLevel() const;
+
+  // return the account with the given full name followed by all the accounts
+  // under it, in depth-first order with children sorted by name
+  std::vector<std::shared_ptr<Account>> Subtree(
+      const std::string& full_name) const;
+
+ private:
+  struct Node {
+    std::shared_ptr<Account> account;
+    std::map<std::string, size_t, std::less<>> children;
+  };
+
+  // return the index of the node with the given full name or 0 (the root) if
+  // there is no such node
+  size_t FindNode(const std::string& full_name) const;
+
+  size_t ParentNode(std::shared_ptr<const Account> account) const;
+
+  // nodes_[0] is the root node whose children are the top-level accounts
+  std::vector<Node> nodes_;
+
+  // index into nodes_ of every account
+  UUIDMap<size_t> node_by_id_;
+};
+
+#endif  // SRC_ACCOUNTTRIE_HPP_
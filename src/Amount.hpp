@@ -58,6 +58,12 @@ class FixedPoint10 {
 
   std::string ToStr() const;
 
+  // approximate value as a double, for bulk computations where the exact fixed
+  // point arithmetic is too slow
+  double ToDouble() const {
+    return static_cast<double>(val_) / std::pow(10.0, D);
+  }
+
   // comparison operators
   bool operator==(const FixedPoint10& other) const {
     return val_ == other.val_;
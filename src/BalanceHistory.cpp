@@ -0,0 +1,131 @@
+/// \file BalanceHistory.cpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#include "BalanceHistory.hpp"
+
+#include <algorithm>
+
+BalanceHistory::BalanceHistory(
+    const std::multimap<Datetime, std::shared_ptr<Transaction>>&
+        transactions_by_date,
+    const std::vector<std::shared_ptr<const Account>>& accounts,
+    int64_t first_day, int64_t last_day, bool include_sub_accounts)
+    : first_day_(first_day),
+      last_day_(last_day),
+      accounts_(accounts),
+      series_(accounts.size()) {
+  if (last_day < first_day)
+    throw std::invalid_argument("BalanceHistory: last day is before first day");
+
+  // position in accounts_ by the account's index in the file, so that the
+  // sweep doesn't need to hash the account ids
+  std::vector<int> account_pos_by_index;
+  for (size_t i = 0; i < accounts_.size(); ++i) {
+    account_pos_.insert({{accounts_[i]->Id(), i}});
+
+    size_t idx = accounts_[i]->Index();
+    if (account_pos_by_index.size() <= idx)
+      account_pos_by_index.resize(idx + 1, -1);
+    account_pos_by_index[idx] = i;
+  }
+
+  // the positions of the series an amount in an account goes into
+  std::vector<std::vector<size_t>> targets(accounts_.size());
+  for (size_t i = 0; i < accounts_.size(); ++i) {
+    targets[i].push_back(i);
+    if (!include_sub_accounts) continue;
+
+    for (auto a = accounts_[i]->Parent(); a != nullptr; a = a->Parent()) {
+      auto it = account_pos_.find(a->Id());
+      if (it != account_pos_.end()) targets[i].push_back(it->second);
+    }
+  }
+
+  // position in coins_ by the coin's index in the file
+  std::vector<int> coin_pos_by_index;
+
+  auto end = transactions_by_date.lower_bound(
+      Datetime::FromUNIXTimestamp((last_day + 1) * 24 * 3600));
+  for (auto it = transactions_by_date.begin(); it != end; ++it) {
+    int64_t day = std::max(it->second->Date().DailyDataDay(), first_day);
+
+    for (auto& s : it->second->Splits()) {
+      size_t acc_idx = s->GetAccount()->Index();
+      if ((acc_idx >= account_pos_by_index.size()) ||
+          (account_pos_by_index[acc_idx] < 0) || (s->GetAmount() == 0))
+        continue;
+
+      size_t coin_idx = s->GetCoin()->Index();
+      if (coin_pos_by_index.size() <= coin_idx)
+        coin_pos_by_index.resize(coin_idx + 1, -1);
+      if (coin_pos_by_index[coin_idx] < 0) {
+        coin_pos_by_index[coin_idx] = coins_.size();
+        coin_pos_.insert({s->GetCoin()->Id(), coins_.size()});
+        coins_.push_back(s->GetCoin());
+      }
+      size_t c = coin_pos_by_index[coin_idx];
+
+      for (size_t t : targets[account_pos_by_index[acc_idx]]) {
+        auto& row = series_[t];
+        if (row.size() <= c) row.resize(c + 1);
+        auto& series = row[c];
+
+        if ((series.days.size() == 0) || (series.days.back() < day)) {
+          Amount prev = series.days.size() == 0 ? Amount(0)
+                                                 : series.balances.back();
+          series.days.push_back(day);
+          series.balances.push_back(prev + s->GetAmount());
+        } else {
+          series.balances.back() += s->GetAmount();
+
+          // drop the change point if the amounts of the day cancelled out
+          size_t n = series.balances.size();
+          Amount prev = n == 1 ? Amount(0) : series.balances[n - 2];
+          if (series.balances.back() == prev) {
+            series.days.pop_back();
+            series.balances.pop_back();
+          }
+        }
+      }
+    }
+  }
+}
+
+Amount BalanceHistory::At(std::shared_ptr<const Account> account,
+    std::shared_ptr<const Coin> coin, int64_t day) const {
+  auto& series = GetSeries(account, coin);
+  size_t n = std::upper_bound(series.days.begin(), series.days.end(), day) -
+             series.days.begin();
+  return n == 0 ? Amount(0) : series.balances[n - 1];
+}
+
+std::vector<Amount> BalanceHistory::Daily(
+    std::shared_ptr<const Account> account,
+    std::shared_ptr<const Coin> coin) const {
+  auto& series = GetSeries(account, coin);
+  std::vector<Amount> res(NumDays());
+
+  // fill the days from each change point to the next one
+  for (size_t i = 0; i < series.days.size(); ++i) {
+    int64_t until =
+        i + 1 < series.days.size() ? series.days[i + 1] : last_day_ + 1;
+    std::fill(res.begin() + (series.days[i] - first_day_),
+        res.begin() + (until - first_day_), series.balances[i]);
+  }
+
+  return res;
+}
+
+const BalanceHistory::Series& BalanceHistory::GetSeries(
+    std::shared_ptr<const Account> account,
+    std::shared_ptr<const Coin> coin) const {
+  auto& row = series_[account_pos_.at(account->Id())];
+  auto it = coin_pos_.find(coin->Id());
+  if ((it == coin_pos_.end()) || (it->second >= row.size())) return empty_;
+  return row[it->second];
+}
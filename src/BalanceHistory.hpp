@@ -0,0 +1,105 @@
+/// \file BalanceHistory.hpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#ifndef SRC_BALANCEHISTORY_HPP_
+#define SRC_BALANCEHISTORY_HPP_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Account.hpp"
+#include "Amount.hpp"
+#include "Coin.hpp"
+#include "Datetime.hpp"
+#include "Transaction.hpp"
+#include "UUID.hpp"
+
+// The daily balance of a set of accounts in every coin over a range of days.
+// Days are UTC days as returned by Datetime::DailyDataDay() and the balance of
+// a day is the balance at the end of that day.
+//
+// The history is built in one sweep over the transactions sorted by date and
+// it is stored delta-encoded: for every (account, coin) only the days on which
+// the balance changed are stored together with the new balance. Dense daily
+// series can be expanded from that on demand.
+
+class BalanceHistory {
+ public:
+  // sweep over the transactions (which must be sorted by date) and record the
+  // balances of the given accounts from first_day to last_day, the
+  // transactions before first_day go into the initial balances, if
+  // include_sub_accounts is true, the balance of an account includes all its
+  // sub accounts that are among the given accounts
+  BalanceHistory(const std::multimap<Datetime,
+                     std::shared_ptr<Transaction>>& transactions_by_date,
+      const std::vector<std::shared_ptr<const Account>>& accounts,
+      int64_t first_day, int64_t last_day, bool include_sub_accounts);
+
+  int64_t FirstDay() const { return first_day_; }
+  int64_t LastDay() const { return last_day_; }
+  size_t NumDays() const { return last_day_ - first_day_ + 1; }
+
+  const std::vector<std::shared_ptr<const Account>>& Accounts() const {
+    return accounts_;
+  }
+
+  // the coins that appear in the history in the order they were first seen
+  const std::vector<std::shared_ptr<const Coin>>& Coins() const {
+    return coins_;
+  }
+
+  // the days on which the balance of the account in the coin changed and the
+  // balances at the end of those days, the first entry is on FirstDay() if
+  // there was a non-zero balance before FirstDay()
+  const std::vector<int64_t>& ChangeDays(std::shared_ptr<const Account> account,
+      std::shared_ptr<const Coin> coin) const {
+    return GetSeries(account, coin).days;
+  }
+  const std::vector<Amount>& ChangeBalances(
+      std::shared_ptr<const Account> account,
+      std::shared_ptr<const Coin> coin) const {
+    return GetSeries(account, coin).balances;
+  }
+
+  // the balance at the end of the given day
+  Amount At(std::shared_ptr<const Account> account,
+      std::shared_ptr<const Coin> coin, int64_t day) const;
+
+  // the balance at the end of every day from FirstDay() to LastDay()
+  std::vector<Amount> Daily(std::shared_ptr<const Account> account,
+      std::shared_ptr<const Coin> coin) const;
+
+ private:
+  struct Series {
+    std::vector<int64_t> days;
+    std::vector<Amount> balances;
+  };
+
+  const Series& GetSeries(std::shared_ptr<const Account> account,
+      std::shared_ptr<const Coin> coin) const;
+
+  int64_t first_day_, last_day_;
+
+  std::vector<std::shared_ptr<const Account>> accounts_;
+  std::vector<std::shared_ptr<const Coin>> coins_;
+
+  UUIDMap<size_t> account_pos_;
+  std::unordered_map<std::string, size_t> coin_pos_;
+
+  // series_[account_pos][coin_pos], rows only extend to the last coin that
+  // was used in the account
+  std::vector<std::vector<Series>> series_;
+
+  // returned for accounts without any amounts in a coin
+  Series empty_;
+};
+
+#endif  // SRC_BALANCEHISTORY_HPP_
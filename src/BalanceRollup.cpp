@@ -0,0 +1,119 @@
+/// \file BalanceRollup.cpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#include "BalanceRollup.hpp"
+
+BalanceRollup::BalanceRollup(
+    const std::vector<std::shared_ptr<const Account>>& roots,
+    const std::vector<std::shared_ptr<const Coin>>& coins,
+    const std::vector<std::vector<Amount>>& balances)
+    : coins_(coins) {
+  for (auto& r : roots) Flatten(r, nodes_.size());
+
+  size_t num_coins = coins_.size();
+  own_.resize(nodes_.size() * num_coins);
+
+  for (size_t pos = 0; pos < nodes_.size(); ++pos) {
+    auto& row = balances.at(nodes_[pos].account->Index());
+    if (row.size() > num_coins)
+      throw std::invalid_argument("Balance of account " +
+                                  nodes_[pos].account->FullName() +
+                                  " has more amounts than there are coins");
+
+    std::copy(row.begin(), row.end(), own_.begin() + pos * num_coins);
+  }
+
+  // children come after their parents, so going backwards adds every subtree
+  // total to its parent after the subtree total is complete
+  total_ = own_;
+  for (size_t pos = nodes_.size(); pos-- > 0;) {
+    size_t parent = nodes_[pos].parent;
+    if (parent == pos) continue;
+
+    auto from = total_.begin() + pos * num_coins;
+    auto to = total_.begin() + parent * num_coins;
+    for (size_t c = 0; c < num_coins; ++c) to[c] += from[c];
+  }
+}
+
+std::vector<std::shared_ptr<const Account>> BalanceRollup::Accounts() const {
+  std::vector<std::shared_ptr<const Account>> res;
+  res.reserve(nodes_.size());
+  for (auto& n : nodes_) res.push_back(n.account);
+  return res;
+}
+
+Balance BalanceRollup::Own(std::shared_ptr<const Account> account) const {
+  return MakeBalance(own_, pos_by_id_.at(account->Id()));
+}
+
+Balance BalanceRollup::Total(std::shared_ptr<const Account> account) const {
+  return MakeBalance(total_, pos_by_id_.at(account->Id()));
+}
+
+std::vector<Amount> BalanceRollup::OwnAmounts(
+    std::shared_ptr<const Account> account) const {
+  auto begin = own_.begin() + pos_by_id_.at(account->Id()) * coins_.size();
+  return std::vector<Amount>(begin, begin + coins_.size());
+}
+
+std::vector<Amount> BalanceRollup::TotalAmounts(
+    std::shared_ptr<const Account> account) const {
+  auto begin = total_.begin() + pos_by_id_.at(account->Id()) * coins_.size();
+  return std::vector<Amount>(begin, begin + coins_.size());
+}
+
+UUIDMap<Balance> BalanceRollup::Totals() const {
+  UUIDMap<Balance> res;
+  for (size_t pos = 0; pos < nodes_.size(); ++pos)
+    res.insert({{nodes_[pos].account->Id(), MakeBalance(total_, pos)}});
+  return res;
+}
+
+void BalanceRollup::Print(std::shared_ptr<const Account> account,
+    bool flip_sign,
+    const std::unordered_map<std::string, Amount>* prices) const {
+  Print(pos_by_id_.at(account->Id()), "", flip_sign, prices);
+}
+
+void BalanceRollup::Flatten(
+    std::shared_ptr<const Account> account, size_t parent) {
+  size_t pos = nodes_.size();
+  pos_by_id_.insert({{account->Id(), pos}});
+  nodes_.push_back({account, parent, 0});
+
+  // children are kept sorted by name
+  for (auto& c : account->Children()) Flatten(c, pos);
+
+  nodes_[pos].end = nodes_.size();
+}
+
+void BalanceRollup::Print(size_t pos, std::string indent, bool flip_sign,
+    const std::unordered_map<std::string, Amount>* prices) const {
+  auto& node = nodes_[pos];
+  printf("%s%s\n", indent.c_str(), node.account->Name().c_str());
+  MakeBalance(own_, pos).Print(indent + "    ", flip_sign, prices);
+
+  if (node.end == pos + 1) return;
+
+  for (size_t c = pos + 1; c < node.end; c = nodes_[c].end)
+    Print(c, indent + "  ", flip_sign, prices);
+
+  printf("%sTOTAL %s\n", indent.c_str(), node.account->Name().c_str());
+  MakeBalance(total_, pos).Print(indent + "    ", flip_sign, prices);
+}
+
+Balance BalanceRollup::MakeBalance(
+    const std::vector<Amount>& amounts, size_t pos) const {
+  Balance balance;
+  for (size_t c = 0; c < coins_.size(); ++c) {
+    auto& amt = amounts[pos * coins_.size() + c];
+    if (amt != 0) balance.AddAmount(amt, coins_[c]);
+  }
+  return balance;
+}
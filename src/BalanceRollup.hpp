@@ -0,0 +1,96 @@
+/// \file BalanceRollup.hpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#ifndef SRC_BALANCEROLLUP_HPP_
+#define SRC_BALANCEROLLUP_HPP_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Account.hpp"
+#include "Amount.hpp"
+#include "Balance.hpp"
+#include "Coin.hpp"
+#include "UUID.hpp"
+
+// The own and total (including all sub accounts) balances of every account in
+// one or more account trees. The trees are flattened in depth-first order with
+// the children sorted by name, so every account comes after its parent and the
+// totals are computed in a single pass over the flattened tree in reverse
+// order (which visits children before their parents). All amounts are stored
+// in flat arrays with one row of per-coin amounts per account.
+
+class BalanceRollup {
+ public:
+  // roll up the balances of the accounts under the given roots, balances[i][c]
+  // is the own balance of the account with Index() i in coins[c], rows may be
+  // shorter than coins (the missing amounts are 0)
+  BalanceRollup(const std::vector<std::shared_ptr<const Account>>& roots,
+      const std::vector<std::shared_ptr<const Coin>>& coins,
+      const std::vector<std::vector<Amount>>& balances);
+
+  const std::vector<std::shared_ptr<const Coin>>& Coins() const {
+    return coins_;
+  }
+
+  // all accounts in depth-first order with children sorted by name
+  std::vector<std::shared_ptr<const Account>> Accounts() const;
+
+  bool Contains(std::shared_ptr<const Account> account) const {
+    return pos_by_id_.count(account->Id()) > 0;
+  }
+
+  // the balance of the account itself and the balance of the account and all
+  // its sub accounts
+  Balance Own(std::shared_ptr<const Account> account) const;
+  Balance Total(std::shared_ptr<const Account> account) const;
+
+  // the per-coin amounts in the same order as Coins()
+  std::vector<Amount> OwnAmounts(std::shared_ptr<const Account> account) const;
+  std::vector<Amount> TotalAmounts(
+      std::shared_ptr<const Account> account) const;
+
+  // the total balance of every account
+  UUIDMap<Balance> Totals() const;
+
+  // print the balance of this account, all the sub account balance trees, and
+  // then print the total balance in this account if it has sub accounts
+  void Print(std::shared_ptr<const Account> account, bool flip_sign,
+      const std::unordered_map<std::string, Amount>* prices) const;
+
+ private:
+  struct Node {
+    std::shared_ptr<const Account> account;
+    // position of the parent, or the node's own position for the roots
+    size_t parent;
+    // one past the position of the last node in this node's subtree
+    size_t end;
+  };
+
+  void Flatten(std::shared_ptr<const Account> account, size_t parent);
+
+  void Print(size_t pos, std::string indent, bool flip_sign,
+      const std::unordered_map<std::string, Amount>* prices) const;
+
+  Balance MakeBalance(const std::vector<Amount>& amounts, size_t pos) const;
+
+  std::vector<std::shared_ptr<const Coin>> coins_;
+
+  std::vector<Node> nodes_;
+
+  UUIDMap<size_t> pos_by_id_;
+
+  // own_[pos * coins_.size() + c] is the own balance of the account at
+  // position pos in coin c, total_ is the same including all sub accounts
+  std::vector<Amount> own_;
+  std::vector<Amount> total_;
+};
+
+#endif  // SRC_BALANCEROLLUP_HPP_
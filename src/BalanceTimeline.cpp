@@ -0,0 +1,91 @@
+/// \file BalanceTimeline.cpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#include "BalanceTimeline.hpp"
+
+#include <algorithm>
+
+namespace {
+
+size_t LowBit(size_t i) { return i & (~i + 1); }
+
+}  // namespace
+
+void BalanceTimeline::Add(Datetime time, Amount amount) {
+  for (auto& b : blocks_) {
+    if (b.times.back() < time) continue;
+
+    size_t i = std::lower_bound(b.times.begin(), b.times.end(), time) -
+               b.times.begin();
+    if (b.times[i] == time) {
+      b.amounts[i] += amount;
+      for (size_t k = i + 1; k <= b.tree.size(); k += LowBit(k))
+        b.tree[k - 1] += amount;
+      return;
+    }
+  }
+
+  Block block;
+  block.times.push_back(time);
+  block.amounts.push_back(amount);
+  block.tree.push_back(amount);
+
+  while ((blocks_.size() > 0) &&
+         (blocks_.back().times.size() == block.times.size())) {
+    block = MergeBlocks(blocks_.back(), block);
+    blocks_.pop_back();
+  }
+  blocks_.push_back(std::move(block));
+}
+
+Amount BalanceTimeline::At(Datetime time) const {
+  Amount sum = 0;
+  for (auto& b : blocks_) {
+    size_t n = std::upper_bound(b.times.begin(), b.times.end(), time) -
+               b.times.begin();
+    sum += PrefixSum(b, n);
+  }
+  return sum;
+}
+
+BalanceTimeline::Block BalanceTimeline::MergeBlocks(
+    const Block& a, const Block& b) {
+  Block res;
+  res.times.reserve(a.times.size() + b.times.size());
+  res.amounts.reserve(a.times.size() + b.times.size());
+
+  size_t i = 0;
+  size_t j = 0;
+  while ((i < a.times.size()) || (j < b.times.size())) {
+    if ((j == b.times.size()) ||
+        ((i < a.times.size()) && (a.times[i] < b.times[j]))) {
+      res.times.push_back(a.times[i]);
+      res.amounts.push_back(a.amounts[i]);
+      ++i;
+    } else {
+      res.times.push_back(b.times[j]);
+      res.amounts.push_back(b.amounts[j]);
+      ++j;
+    }
+  }
+
+  // build the tree in O(n) by adding every node to its parent
+  res.tree = res.amounts;
+  for (size_t k = 1; k <= res.tree.size(); ++k) {
+    size_t parent = k + LowBit(k);
+    if (parent <= res.tree.size()) res.tree[parent - 1] += res.tree[k - 1];
+  }
+
+  return res;
+}
+
+Amount BalanceTimeline::PrefixSum(const Block& block, size_t n) {
+  Amount sum = 0;
+  for (size_t k = n; k > 0; k -= LowBit(k)) sum += block.tree[k - 1];
+  return sum;
+}
@@ -0,0 +1,63 @@
+/// \file BalanceTimeline.hpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#ifndef SRC_BALANCETIMELINE_HPP_
+#define SRC_BALANCETIMELINE_HPP_
+
+#include <vector>
+
+#include "Amount.hpp"
+#include "Datetime.hpp"
+
+// The amounts added to a balance over time, used to get the balance at any
+// point in time. The times are kept in a few sorted blocks, each with a Fenwick
+// tree (binary indexed tree) of its amounts, and no time is in more than one
+// block. The balance at a time is the sum of one prefix sum per block.
+//
+// The blocks have distinct power of two sizes, so there are at most log n of
+// them. Adding an amount at a time that is already in a block updates that
+// block's tree. A new time starts a block of size 1 and blocks of the same size
+// are merged like the carries of a binary counter, so every time is merged
+// O(log n) times in total, no matter in which order the times are added.
+// Queries take O(log^2 n) and never change the timeline.
+
+class BalanceTimeline {
+ public:
+  BalanceTimeline() {}
+
+  bool Empty() const { return blocks_.size() == 0; }
+
+  void Add(Datetime time, Amount amount);
+
+  // the sum of all amounts added at or before time
+  Amount At(Datetime time) const;
+
+  // the sum of all amounts added after from and at or before to
+  Amount Change(Datetime from, Datetime to) const { return At(to) - At(from); }
+
+ private:
+  struct Block {
+    // the sorted times, the amounts added at each time, and the Fenwick tree
+    // of the amounts where tree[i - 1] is the sum of the amounts with
+    // (1-based) indices i - lowbit(i) + 1 through i
+    std::vector<Datetime> times;
+    std::vector<Amount> amounts;
+    std::vector<Amount> tree;
+  };
+
+  // merge the times of two blocks, which have no time in common
+  static Block MergeBlocks(const Block& a, const Block& b);
+
+  // sum of the first n amounts of the block
+  static Amount PrefixSum(const Block& block, size_t n);
+
+  // the blocks from the largest to the smallest
+  std::vector<Block> blocks_;
+};
+
+#endif  // SRC_BALANCETIMELINE_HPP_
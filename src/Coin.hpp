@@ -28,6 +28,10 @@ class Coin {
   const std::string& Symbol() const { return symbol_; }
   int NumId() const { return num_id_; }
 
+  // dense index of this coin among the coins that are used in the splits of
+  // the file, -1 if no split uses this coin
+  int Index() const { return index_; }
+
   bool IsUSD() const { return id_ == USD_id(); }
 
   void SetNumId(int num_id) { num_id_ = num_id; }
@@ -36,7 +40,7 @@ class Coin {
   friend class File;
 
   Coin(std::string id, std::string name, std::string symbol, int num_id)
-      : id_(id), name_(name), symbol_(symbol), num_id_(num_id) {}
+      : id_(id), name_(name), symbol_(symbol), num_id_(num_id), index_(-1) {}
 
   // unique global identifier of this coin
   const std::string id_;
@@ -49,6 +53,9 @@ class Coin {
 
   // CoinMarketCap numeric id
   int num_id_;
+
+  // dense index assigned by the file when the coin is first used in a split
+  int index_;
 };
 
 #endif  // SRC_COIN_HPP_
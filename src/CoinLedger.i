@@ -18,11 +18,19 @@
 #include "Account.hpp"
 #include "Amount.hpp"
 #include "Balance.hpp"
+#include "BalanceHistory.hpp"
+#include "BalanceRollup.hpp"
 #include "Coin.hpp"
 #include "Datetime.hpp"
+#include "FederatedFile.hpp"
+#include "PeriodSummary.hpp"
 #include "Split.hpp"
+#include "SplitPostings.hpp"
+#include "TextIndex.hpp"
 #include "Transaction.hpp"
+#include "TransactionQuery.hpp"
 #include "UUID.hpp"
+#include "ValuationHistory.hpp"
 #include "File.hpp"
 
 #include "importers/Binance.hpp"
@@ -44,25 +52,51 @@
 
 #include "taxes/Inventory.hpp"
 #include "taxes/Taxes.hpp"
+#include "taxes/TaxCheckpoint.hpp"
 %}
 
 %template(vec_str) std::vector<std::string>;
+%template(vec_double) std::vector<double>;
 %template(vec_vec_str) std::vector<std::vector<std::string>>;
 %template(map_str_str) std::map<std::string, std::string>;
+%template(map_str_vec_str) std::map<std::string, std::vector<std::string>>;
+%template(vec_Account) std::vector<std::shared_ptr<Account>>;
+%template(vec_Transaction) std::vector<std::shared_ptr<Transaction>>;
+%template(vec_StatementLine) std::vector<StatementLine>;
 
 %ignore std::vector<ProtoSplit>::vector(size_type);
 %ignore std::vector<ProtoSplit>::resize(size_type);
 %template(vec_ProtoSplit) std::vector<ProtoSplit>;
 
+%ignore std::vector<Datetime>::vector(size_type);
+%ignore std::vector<Datetime>::resize(size_type);
+%template(vec_Datetime) std::vector<Datetime>;
+%ignore std::vector<TaxScenario>::vector(size_type);
+%ignore std::vector<TaxScenario>::resize(size_type);
+%template(vec_TaxScenario) std::vector<TaxScenario>;
+%ignore std::vector<TaxScenarioTotals>::vector(size_type);
+%ignore std::vector<TaxScenarioTotals>::resize(size_type);
+%template(vec_TaxScenarioTotals) std::vector<TaxScenarioTotals>;
+
 %include "Account.hpp"
 %include "Amount.hpp"
 %include "Balance.hpp"
+%include "BalanceHistory.hpp"
+%include "BalanceRollup.hpp"
 %include "Coin.hpp"
 %ignore operator<;
 %include "Datetime.hpp"
+%include "PeriodSummary.hpp"
 %include "Split.hpp"
+%include "SplitPostings.hpp"
+%include "TextIndex.hpp"
 %include "Transaction.hpp"
+%ignore TransactionCursor::iterator;
+%ignore TransactionCursor::begin;
+%ignore TransactionCursor::end;
+%include "TransactionQuery.hpp"
 %include "UUID.hpp"
+%include "ValuationHistory.hpp"
 %include "File.hpp"
 
 %include "importers/Binance.hpp"
@@ -85,5 +119,8 @@
 
 %include "taxes/Inventory.hpp"
 %include "taxes/Taxes.hpp"
+%include "taxes/TaxCheckpoint.hpp"
+
+%include "FederatedFile.hpp"
 
 %template(Amount) FixedPoint10<20>;
@@ -58,17 +58,20 @@ std::string Datetime::ToStrLocalFile() const {
 // }
 
 std::string Datetime::ToStrUTC() const {
-  struct tm* utc = gmtime(&time_);
+  struct tm utc_tm;
+  struct tm* utc = gmtime_r(&time_, &utc_tm);
   return ToStr(utc, "%F %T");
 }
 
 std::string Datetime::ToStrDayUTC() const {
-  struct tm* utc = gmtime(&time_);
+  struct tm utc_tm;
+  struct tm* utc = gmtime_r(&time_, &utc_tm);
   return ToStr(utc, "%F");
 }
 
 std::string Datetime::ToStrDayUTCIRS() const {
-  struct tm* utc = gmtime(&time_);
+  struct tm utc_tm;
+  struct tm* utc = gmtime_r(&time_, &utc_tm);
   return ToStr(utc, "%m/%d/%Y");
 }
 
@@ -76,11 +79,28 @@ Datetime Datetime::EndOfDay() const {
   // if we don't want to account for leap seconds, we could just round down the
   // UNIX timestamp to a multiple of 86400, but we'll use struct tm instead to
   // account for leap seconds
-  struct tm* utc = gmtime(&time_);
+  struct tm utc_tm;
+  struct tm* utc = gmtime_r(&time_, &utc_tm);
   return MakeDatetime(
       utc->tm_year + 1900, utc->tm_mon + 1, utc->tm_mday, 23, 59, 59, true);
 }
 
+void Datetime::CivilFromDay(
+    int64_t day, int* year, int* month, int* day_of_month) {
+  // shift the epoch to 0000-03-01 so that leap days are at the end of the
+  // (March-based) year and split the days into 400-year eras of 146097 days
+  int64_t z = day + 719468;
+  int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  int64_t doe = z - era * 146097;
+  int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int64_t mp = (5 * doy + 2) / 153;
+
+  *day_of_month = doy - (153 * mp + 2) / 5 + 1;
+  *month = mp < 10 ? mp + 3 : mp - 9;
+  *year = yoe + era * 400 + (*month <= 2 ? 1 : 0);
+}
+
 int64_t Datetime::DailyDataDayFromStr(std::string str) {
   int day, month, year;
   if (sscanf(str.c_str(), "%4d-%2d-%2dT23:59:59.999Z", &year, &month, &day) != 3)
@@ -130,9 +150,10 @@ Datetime Datetime::MakeDatetime(struct tm tm_time, bool UTC) {
 
     // find offset between local and UTC
     time_t zero = 0;
-    struct tm* utc_tm = gmtime(&zero);
-    utc_tm->tm_isdst = 0;
-    time_t utc_time = mktime(utc_tm);
+    struct tm utc_tm;
+    gmtime_r(&zero, &utc_tm);
+    utc_tm.tm_isdst = 0;
+    time_t utc_time = mktime(&utc_tm);
 
     return Datetime(local - utc_time);
   } else {
@@ -79,6 +79,11 @@ class Datetime {
   }
   static int64_t DailyDataDayFromStr(std::string str);
 
+  // convert a day (as used in DailyData) to the UTC calendar date without
+  // going through libc, month and day_of_month start at 1
+  static void CivilFromDay(
+      int64_t day, int* year, int* month, int* day_of_month);
+
   static int GetMonth(const char *str);
 
   bool operator==(const Datetime& other) const { return time_ == other.time_; }
@@ -0,0 +1,111 @@
+/// \file FederatedFile.cpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#include "FederatedFile.hpp"
+
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include "Parallel.hpp"
+
+FederatedFile FederatedFile::Open(
+    const std::vector<std::string>& paths, size_t num_threads) {
+  std::vector<std::string> names;
+  for (auto& p : paths)
+    names.push_back(boost::filesystem::path(p).stem().string());
+
+  return Open(paths, names, num_threads);
+}
+
+FederatedFile FederatedFile::Open(const std::vector<std::string>& paths,
+    const std::vector<std::string>& names, size_t num_threads) {
+  if (names.size() != paths.size())
+    throw std::invalid_argument("Got " + std::to_string(paths.size()) +
+                                " files but " + std::to_string(names.size()) +
+                                " names");
+
+  // the files are independent, so each one is read in one thread
+  std::vector<std::unique_ptr<File>> opened(paths.size());
+  ParallelChunks(paths.size(), num_threads,
+      [&](size_t /*chunk*/, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+          opened[i].reset(new File(File::Open(paths[i])));
+      });
+
+  std::vector<File> files;
+  for (auto& f : opened) files.push_back(std::move(*f));
+
+  return FederatedFile(names, std::move(files));
+}
+
+FederatedFile::FederatedFile(
+    std::vector<std::string> names, std::vector<File> files)
+    : names_(names), files_(std::move(files)) {
+  for (size_t i = 0; i < files_.size(); ++i)
+    view_.AddFileUnder(files_[i], names_[i]);
+}
+
+std::shared_ptr<const Account> FederatedFile::GetAccount(
+    const std::string& name, const std::string& fullname) const {
+  return view_.GetAccount(name + "::" + fullname);
+}
+
+std::vector<std::shared_ptr<const Account>> FederatedFile::GetAccounts(
+    const std::string& fullname) const {
+  std::vector<std::shared_ptr<const Account>> accounts;
+  for (auto& name : names_) {
+    auto accnt = view_.account_trie_.Find(name + "::" + fullname);
+    if (accnt != nullptr) accounts.push_back(accnt);
+  }
+
+  return accounts;
+}
+
+Balance FederatedFile::ConsolidatedBalance(const std::string& fullname) const {
+  Balance balance;
+  for (auto& a : GetAccounts(fullname)) balance += view_.GetBalance(a, true);
+  return balance;
+}
+
+PeriodSummary FederatedFile::MakePeriodSummary(
+    Period period, const std::string& fullname) const {
+  if (fullname == "") return view_.MakePeriodSummary(period);
+
+  std::vector<std::shared_ptr<const Account>> accounts;
+  for (auto& a : GetAccounts(fullname)) {
+    auto sub = view_.SubtreeAccounts(a);
+    accounts.insert(accounts.end(), sub.begin(), sub.end());
+  }
+
+  std::vector<std::shared_ptr<const Coin>> coins(
+      view_.coin_list_.begin(), view_.coin_list_.end());
+  auto& by_date = view_.TransactionsByDate();
+  auto from = by_date.size() > 0 ? by_date.begin()->first : Datetime::Now();
+  auto to = by_date.size() > 0 ? by_date.rbegin()->first : Datetime::Now();
+
+  return PeriodSummary(by_date, accounts, coins, from.DailyDataDay(),
+      to.DailyDataDay(), period);
+}
+
+Taxes FederatedFile::MakeTaxes(Datetime until, const std::string& assets,
+    const std::string& wallets, const std::string& ecr20_account,
+    const std::string& exchanges, const std::string& equity,
+    const std::string& expenses, const std::string& expense_mining_fees,
+    const std::string& expense_trading_fees,
+    const std::string& expense_transaction_fees,
+    const std::string& income_other, const std::string& income_mining,
+    const std::string& income_trade,
+    const std::vector<std::string>& ignore_txns) const {
+  return Taxes(view_, until, GetAccounts(assets), GetAccounts(wallets),
+      GetAccounts(ecr20_account), GetAccounts(exchanges), GetAccounts(equity),
+      GetAccounts(expenses), GetAccounts(expense_mining_fees),
+      GetAccounts(expense_trading_fees), GetAccounts(expense_transaction_fees),
+      GetAccounts(income_other), GetAccounts(income_mining),
+      GetAccounts(income_trade), ignore_txns);
+}
@@ -0,0 +1,97 @@
+/// \file FederatedFile.hpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#ifndef SRC_FEDERATEDFILE_HPP_
+#define SRC_FEDERATEDFILE_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Account.hpp"
+#include "Balance.hpp"
+#include "Datetime.hpp"
+#include "File.hpp"
+#include "PeriodSummary.hpp"
+#include "taxes/Taxes.hpp"
+
+// A read-only view of several CoinLedger files as if they were one, e.g. the
+// ledgers of the members of a household. The files are opened in parallel and
+// their union is built in memory, nothing is written to disk. Coins are
+// identified by their id, and the accounts of each file are put under a
+// top-level account with the name of the file, so that the account
+// Assets::Wallets of the file "alice" becomes alice::Assets::Wallets in the
+// view. The view is an ordinary File, so everything that works on a File
+// (balances, period summaries, queries, the Print* functions of Taxes) works
+// on the union, but the view must not be modified or saved.
+
+class FederatedFile {
+ public:
+  // open the files in up to num_threads threads (0 means one thread per core),
+  // the names are used as the top-level accounts of the files in the view, by
+  // default the name of a file is its file name without the extension
+  static FederatedFile Open(
+      const std::vector<std::string>& paths, size_t num_threads = 0);
+  static FederatedFile Open(const std::vector<std::string>& paths,
+      const std::vector<std::string>& names, size_t num_threads = 0);
+
+  size_t NumFiles() const { return files_.size(); }
+  const std::string& Name(size_t i) const { return names_.at(i); }
+
+  // the file as it was opened, not the view
+  const File& GetFile(size_t i) const { return files_.at(i); }
+
+  // the union of all files
+  const File& View() const { return view_; }
+
+  // the account of the file with the given name in the view, fullname is the
+  // full name of the account in that file, throw an exception if there is no
+  // such account
+  std::shared_ptr<const Account> GetAccount(
+      const std::string& name, const std::string& fullname) const;
+
+  // the accounts in the view that have the given full name in their file,
+  // files that don't have such an account are skipped
+  std::vector<std::shared_ptr<const Account>> GetAccounts(
+      const std::string& fullname) const;
+
+  // the balance of the account with the given full name summed over all the
+  // files, including all sub accounts
+  Balance ConsolidatedBalance(const std::string& fullname) const;
+
+  UUIDMap<Balance> MakeAccountBalances() const {
+    return view_.MakeAccountBalances();
+  }
+
+  // sum the inflows and outflows of the accounts with the given full name in
+  // all the files, or of all accounts if fullname is empty
+  PeriodSummary MakePeriodSummary(
+      Period period, const std::string& fullname = "") const;
+
+  // compute the taxes of all the files together, the accounts are given by
+  // their full names within each file and a split has a role if it is under
+  // the account of that role in any of the files
+  Taxes MakeTaxes(Datetime until, const std::string& assets,
+      const std::string& wallets, const std::string& ecr20_account,
+      const std::string& exchanges, const std::string& equity,
+      const std::string& expenses, const std::string& expense_mining_fees,
+      const std::string& expense_trading_fees,
+      const std::string& expense_transaction_fees,
+      const std::string& income_other, const std::string& income_mining,
+      const std::string& income_trade,
+      const std::vector<std::string>& ignore_txns) const;
+
+ private:
+  FederatedFile(std::vector<std::string> names, std::vector<File> files);
+
+  std::vector<std::string> names_;
+  std::vector<File> files_;
+  File view_;
+};
+
+#endif  // SRC_FEDERATEDFILE_HPP_
@@ -8,48 +8,19 @@
 
 #include "File.hpp"
 
+#include <atomic>
 #include <stdexcept>
+#include <unordered_set>
 
 #include <sqlite3.h>
 #include <boost/filesystem.hpp>
 
 #include "Datetime.hpp"
+#include "Parallel.hpp"
+#include "SQLite.hpp"
 #include "prices/PriceSource.hpp"
 
-// convenience macros for sqlite3 calls
-#define SQL3(db, COMMAND)                                         \
-  if ((COMMAND) != SQLITE_OK) {                                   \
-    printf("ERROR: SQL error at %s:%i: %s\n", __FILE__, __LINE__, \
-        sqlite3_errmsg(db));                                      \
-    { SQL3_FAIL; }                                                \
-  }
-
-#define SQL3_EXEC(db, sql, callback, callback_arg)                           \
-  {                                                                          \
-    char* error_msg = nullptr;                                               \
-    if (sqlite3_exec(db, sql, callback, callback_arg, &error_msg) !=         \
-        SQLITE_OK) {                                                         \
-      printf(                                                                \
-          "ERROR: SQL error at %s:%i: %s\n", __FILE__, __LINE__, error_msg); \
-      sqlite3_free(error_msg);                                               \
-      { SQL3_FAIL; }                                                         \
-    }                                                                        \
-  }
-
-inline int sqlite3_bind_str(
-    sqlite3_stmt* stmt, int pos, const std::string& str) {
-  return sqlite3_bind_text(stmt, pos, str.c_str(), -1, SQLITE_TRANSIENT);
-}
-
-inline std::string sqlite3_column_str(sqlite3_stmt* stmt, int iCol) {
-  const unsigned char* ptr = sqlite3_column_text(stmt, iCol);
-  if (ptr == nullptr)
-    return "";
-  else
-    return std::string((const char*)ptr);
-}
-
-File File::InitNewFile() {
+File File::InitNewFile(bool add_all_coins) {
   File file;
 
   // create root accounts
@@ -61,7 +32,7 @@ File File::InitNewFile() {
 
   // add all known coins
   Coin::Create(&file, Coin::USD_id(), "US Dollar", "USD", -1);
-  PriceSource::AddAllCoins(&file);
+  if (add_all_coins) PriceSource::AddAllCoins(&file);
 
   return file;
 }
@@ -132,8 +103,12 @@ File File::Open(const std::string& path) {
         coin = file.coins_.at(coin_id);
       }
 
-      file.accounts_.emplace(id, std::make_shared<Account>(Account(id, name,
-                                     placeholder, nullptr, single_coin, coin)));
+      auto accnt = file.accounts_
+                       .emplace(id, std::make_shared<Account>(Account(id, name,
+                                        placeholder, nullptr, single_coin,
+                                        coin)))
+                       .first->second;
+      file.IndexAccount(accnt);
 
       res = sqlite3_step(stmt);
     }
@@ -152,10 +127,18 @@ File File::Open(const std::string& path) {
       }
     }
 
-    // make map of full names
+    // build the trie of full names, parents need to be attached before their
+    // children
+    std::vector<std::shared_ptr<Account>> to_attach;
     for (auto& entry : file.accounts_) {
-      auto& accnt = entry.second;
-      file.accounts_by_fullname_.insert({{accnt->FullName(), accnt}});
+      if (entry.second->Parent() == nullptr) to_attach.push_back(entry.second);
+    }
+    while (to_attach.size() > 0) {
+      auto accnt = to_attach.back();
+      to_attach.pop_back();
+      file.account_trie_.Attach(accnt);
+      for (auto& c : accnt->children_)
+        to_attach.push_back(file.accounts_.at(c->Id()));
     }
   }
 
@@ -172,11 +155,7 @@ File File::Open(const std::string& path) {
       std::string description = sqlite3_column_str(stmt, 2);
       std::string import_id = sqlite3_column_str(stmt, 3);
 
-      auto txn = file.transactions_
-                     .emplace(id, std::make_shared<Transaction>(Transaction(
-                                      id, date, description, import_id)))
-                     .first->second;
-      file.transactions_by_import_id_.insert({{import_id, txn}});
+      file.AddTransaction(Transaction(id, date, description, import_id));
       res = sqlite3_step(stmt);
     }
     if (res != SQLITE_DONE) SQL3(db, res);
@@ -203,10 +182,8 @@ File File::Open(const std::string& path) {
       auto account = file.accounts_.at(account_id);
       auto coin = file.coins_.at(coin_id);
 
-      auto iter = file.splits_.emplace(id,
-          std::make_shared<Split>(
-              Split(id, transaction, account, memo, amount, coin, import_id)));
-      transaction->AddSplit(iter.first->second);
+      file.AddSplit(
+          Split(id, transaction, account, memo, amount, coin, import_id));
       res = sqlite3_step(stmt);
     }
     if (res != SQLITE_DONE) SQL3(db, res);
@@ -593,21 +570,406 @@ std::shared_ptr<const Coin> File::GetCoinBySymbol(std::string symbol) const {
 
 std::shared_ptr<Transaction> File::GetTransactionFromImportId(
     const std::string& import_id, bool fail_if_not_exist) {
-  auto count = transactions_by_import_id_.count(import_id);
-  if (count == 0) {
+  auto range = transactions_by_import_id_.equal_range(import_id);
+  if (range.first == range.second) {
     if (fail_if_not_exist)
       throw std::invalid_argument(
           "No transaction with import id '" + import_id + "' exists");
     else
       return nullptr;
-  } else if (count == 1) {
-    return transactions_by_import_id_.find(import_id)->second;
+  } else if (std::next(range.first) == range.second) {
+    return range.first->second;
   }
+  auto count = std::distance(range.first, range.second);
   throw std::invalid_argument("There are " + std::to_string(count) +
                               " transactions with import id '" + import_id +
                               "'");
 }
 
+std::shared_ptr<Split> File::AddSplit(const Split& split) {
+  auto res =
+      splits_.emplace(split.Id(), std::make_shared<Split>(split)).first->second;
+
+  auto txn = transactions_.at(res->GetTransaction()->Id());
+  txn->AddSplit(res);
+  UpdateTransactionStatus(txn);
+
+  if (res->GetCoin()->Index() < 0) {
+    auto coin = coins_.at(res->GetCoin()->Id());
+    coin->index_ = coin_list_.size();
+    coin_list_.push_back(coin);
+    coin_postings_.emplace_back();
+  }
+  AddToBalances(res->GetAccount(), res->GetCoin()->Index(),
+      res->GetTransaction()->Date(), res->GetAmount());
+  account_postings_[res->GetAccount()->Index()].Add(res);
+  coin_postings_[res->GetCoin()->Index()].Add(res);
+
+  split_list_.push_back(res);
+  text_index_.Add(txn->Index(), res->Memo());
+  if (res->Import_id() != "")
+    splits_by_import_id_.insert({{res->Import_id(), res}});
+
+  return res;
+}
+
+bool File::HasSplitImportId(const std::string& import_id,
+    std::shared_ptr<const Transaction> txn) const {
+  // for small transactions, scanning the splits is cheaper than hashing
+  if ((txn != nullptr) && (txn->Splits().size() <= 64))
+    return txn->HasSplitWithImportId(import_id);
+
+  auto range = splits_by_import_id_.equal_range(import_id);
+  if (txn == nullptr) return range.first != range.second;
+
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second->GetTransaction()->Id() == txn->Id()) return true;
+  }
+  return false;
+}
+
+std::shared_ptr<Split> File::FindSplitByImportId(
+    const std::string& import_id) const {
+  auto range = splits_by_import_id_.equal_range(import_id);
+  if (range.first == range.second) return nullptr;
+  return range.first->second;
+}
+
+std::vector<std::shared_ptr<Transaction>> File::TransactionsBetween(
+    Datetime from, Datetime to) const {
+  std::vector<std::shared_ptr<Transaction>> txns;
+  if (to < from) return txns;
+
+  auto end = transactions_by_date_.upper_bound(to);
+  for (auto it = transactions_by_date_.lower_bound(from); it != end; ++it)
+    txns.push_back(it->second);
+  return txns;
+}
+
+std::vector<std::shared_ptr<Transaction>> File::SearchText(
+    const std::string& text, TextIndex::Match match) const {
+  std::vector<std::shared_ptr<Transaction>> txns;
+  for (uint32_t idx : text_index_.Find(text, match))
+    txns.push_back(transaction_list_[idx]);
+
+  std::stable_sort(txns.begin(), txns.end(),
+      [](std::shared_ptr<const Transaction> a,
+          std::shared_ptr<const Transaction> b) {
+        return a->Date() < b->Date();
+      });
+
+  return txns;
+}
+
+const SplitPostings& File::CoinPostings(
+    std::shared_ptr<const Coin> coin) const {
+  static const SplitPostings empty;
+  if (coin->Index() < 0) return empty;
+  return coin_postings_[coin->Index()];
+}
+
+std::vector<StatementLine> File::AccountStatement(
+    std::shared_ptr<const Account> account, Datetime from, Datetime to,
+    bool include_sub_accounts) const {
+  std::vector<const SplitPostings*> postings;
+  if (include_sub_accounts) {
+    for (auto& a : SubtreeAccounts(account))
+      postings.push_back(&account_postings_[a->Index()]);
+  } else {
+    postings.push_back(&account_postings_[account->Index()]);
+  }
+  MergedSplits merged(postings, from, to);
+
+  return MakeStatement(
+      &merged, TimelinesAt(account, include_sub_accounts, to));
+}
+
+std::vector<StatementLine> File::CoinHistory(std::shared_ptr<const Coin> coin,
+    Datetime from, Datetime to, std::shared_ptr<const Account> account) const {
+  if (coin->Index() < 0) return {};
+  int c = coin->Index();
+
+  std::vector<const SplitPostings*> postings;
+  if (account == nullptr) {
+    postings.push_back(&coin_postings_[c]);
+  } else {
+    // the splits in other coins are skipped by MakeStatement
+    for (auto& a : SubtreeAccounts(account))
+      postings.push_back(&account_postings_[a->Index()]);
+  }
+  MergedSplits merged(postings, from, to);
+
+  return MakeStatement(&merged, TimelinesAt(account, true, to, c), c);
+}
+
+TransactionCursor File::Query(const TransactionQuery& query) const {
+  auto begin = transactions_by_date_.begin();
+  auto end = transactions_by_date_.end();
+  if (query.GetFrom())
+    begin = transactions_by_date_.lower_bound(*query.GetFrom());
+  if (query.GetTo()) end = transactions_by_date_.upper_bound(*query.GetTo());
+
+  // with to before from, begin is after end, so the date range is empty
+  if (query.GetFrom() && query.GetTo() && (*query.GetTo() < *query.GetFrom()))
+    end = begin;
+
+  // estimate the number of transactions in the date range from the fraction of
+  // the whole history it covers
+  double date_estimate = transactions_by_date_.size();
+  if ((transactions_by_date_.size() > 1) &&
+      (query.GetFrom() || query.GetTo())) {
+    auto first = transactions_by_date_.begin()->first;
+    auto last = transactions_by_date_.rbegin()->first;
+    double span = last.AbsDiffInSeconds(first) + 1;
+    Datetime from = query.GetFrom() ? std::max(*query.GetFrom(), first) : first;
+    Datetime to = query.GetTo() ? std::min(*query.GetTo(), last) : last;
+    date_estimate *=
+        to < from ? 0.0 : (to.AbsDiffInSeconds(from) + 1) / span;
+  }
+
+  // the transactions in a list, sorted by date, only used for short lists
+  auto from_list = [](std::vector<std::shared_ptr<Transaction>> list) {
+    auto txns =
+        std::make_shared<std::vector<std::shared_ptr<Transaction>>>(list);
+    std::stable_sort(txns->begin(), txns->end(),
+        [](std::shared_ptr<const Transaction> a,
+            std::shared_ptr<const Transaction> b) {
+          return a->Date() < b->Date();
+        });
+
+    size_t i = 0;
+    return TransactionCursor::Source(
+        [txns, i]() mutable -> std::shared_ptr<Transaction> {
+          return i < txns->size() ? (*txns)[i++] : nullptr;
+        });
+  };
+  auto from_set = [&](const UUIDMap<std::shared_ptr<Transaction>>& set) {
+    std::vector<std::shared_ptr<Transaction>> list;
+    for (auto& e : set) list.push_back(e.second);
+    return from_list(list);
+  };
+
+  // the text index gives the exact number of candidates
+  if (query.GetText() != "") {
+    auto idxs = text_index_.Find(query.GetText(), query.GetTextMatch());
+    if (idxs.size() < date_estimate) {
+      std::vector<std::shared_ptr<Transaction>> list;
+      for (uint32_t idx : idxs) list.push_back(transaction_list_[idx]);
+      return TransactionCursor(from_list(list), query, "text index");
+    }
+  }
+
+  // the transactions of the merged splits, a transaction with several of the
+  // splits is only returned once
+  auto from_postings = [this](std::shared_ptr<MergedSplits> merged) {
+    // the transactions returned at the date of the last split
+    std::unordered_set<size_t> seen;
+    auto date = Datetime::FromUNIXTimestamp(0);
+    return TransactionCursor::Source(
+        [this, merged, seen, date]() mutable -> std::shared_ptr<Transaction> {
+          for (auto s = merged->Next(); s != nullptr; s = merged->Next()) {
+            auto& txn = transaction_list_[s->GetTransaction()->Index()];
+            if (txn->Date() != date) {
+              seen.clear();
+              date = txn->Date();
+            }
+            if (seen.insert(txn->Index()).second) return txn;
+          }
+          return nullptr;
+        });
+  };
+
+  // the posting lists give the exact number of candidate splits, which is at
+  // least the number of candidate transactions
+  if ((transactions_by_date_.size() > 0) &&
+      ((query.GetAccount() != nullptr) || (query.GetCoin() != nullptr))) {
+    Datetime from = query.GetFrom() ? *query.GetFrom()
+                                    : transactions_by_date_.begin()->first;
+    Datetime to =
+        query.GetTo() ? *query.GetTo() : transactions_by_date_.rbegin()->first;
+
+    std::shared_ptr<MergedSplits> by_account, by_coin;
+    if (query.GetAccount() != nullptr) {
+      std::vector<const SplitPostings*> postings;
+      for (auto& a : SubtreeAccounts(query.GetAccount()))
+        postings.push_back(&account_postings_[a->Index()]);
+      by_account = std::make_shared<MergedSplits>(postings, from, to);
+    }
+    if (query.GetCoin() != nullptr)
+      by_coin = std::make_shared<MergedSplits>(
+          std::vector<const SplitPostings*>{&CoinPostings(query.GetCoin())},
+          from, to);
+
+    if ((by_account != nullptr) &&
+        ((by_coin == nullptr) || (by_account->Size() <= by_coin->Size())) &&
+        (by_account->Size() < date_estimate))
+      return TransactionCursor(
+          from_postings(by_account), query, "account postings");
+
+    if ((by_coin != nullptr) && (by_coin->Size() < date_estimate))
+      return TransactionCursor(from_postings(by_coin), query, "coin postings");
+  }
+
+  // unmatched transactions are also unbalanced
+  if (query.GetMatched() && !*query.GetMatched() &&
+      (unmatched_transactions_.size() < date_estimate))
+    return TransactionCursor(
+        from_set(unmatched_transactions_), query, "unmatched transactions");
+
+  if (query.GetBalanced() && !*query.GetBalanced() &&
+      (unbalanced_transactions_.size() < date_estimate))
+    return TransactionCursor(
+        from_set(unbalanced_transactions_), query, "unbalanced transactions");
+
+  return TransactionCursor(
+      [begin, end]() mutable -> std::shared_ptr<Transaction> {
+        return begin == end ? nullptr : (begin++)->second;
+      },
+      query, "transactions by date");
+}
+
+void File::SetTransactionDate(
+    std::shared_ptr<Transaction> txn, Datetime date) {
+  auto range = transactions_by_date_.equal_range(txn->Date());
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second->Id() == txn->Id()) {
+      transactions_by_date_.erase(it);
+      break;
+    }
+  }
+
+  // move the amounts of the splits to the new date in the balance timelines,
+  // the splits are taken out of the posting lists while their date changes
+  for (auto& s : txn->Splits()) {
+    AddToBalances(
+        s->GetAccount(), s->GetCoin()->Index(), txn->Date(), -s->GetAmount());
+    AddToBalances(s->GetAccount(), s->GetCoin()->Index(), date, s->GetAmount());
+    account_postings_[s->GetAccount()->Index()].Remove(s);
+    coin_postings_[s->GetCoin()->Index()].Remove(s);
+  }
+
+  txn->SetDate(date);
+  transactions_by_date_.insert({{date, txn}});
+
+  for (auto& s : txn->Splits()) {
+    account_postings_[s->GetAccount()->Index()].Add(s);
+    coin_postings_[s->GetCoin()->Index()].Add(s);
+  }
+}
+
+void File::AddFileUnder(const File& other, const std::string& name) {
+  if (GetAccount(nullptr, name) != nullptr)
+    throw std::invalid_argument("Account '" + name + "' already exists");
+
+  // the coin indices of the other file don't apply here
+  for (auto& c : other.coins_) {
+    auto& coin = *c.second;
+    if (coins_.count(c.first) == 0)
+      AddCoin(Coin(coin.Id(), coin.Name(), coin.Symbol(), coin.NumId()));
+  }
+  // keep the longer price history
+  for (auto& d : other.daily_data_) {
+    auto it = daily_data_.find(d.first);
+    if ((it != daily_data_.end()) &&
+        (it->second.Prices().size() >= d.second.Prices().size()))
+      continue;
+    DailyData data(coins_.at(d.first), d.second.StartDay(), d.second.Prices());
+    if (it == daily_data_.end())
+      daily_data_.insert({{d.first, data}});
+    else
+      it->second = data;
+  }
+
+  // parents come before their children in the subtrees
+  auto top = Account::Create(this, name, true, nullptr, false);
+  for (auto& t : other.account_trie_.TopLevel()) {
+    for (auto& a : other.account_trie_.Subtree(t->FullName())) {
+      if (accounts_.count(a->Id()) > 0)
+        throw std::invalid_argument("Account " + a->FullName() + " (" +
+                                    a->Id().ToString() +
+                                    ") is already in the file");
+
+      auto parent =
+          a->Parent() == nullptr ? top : accounts_.at(a->Parent()->Id());
+      auto coin = a->GetCoin() == nullptr ? nullptr
+                                          : coins_.at(a->GetCoin()->Id());
+      auto accnt = AddAccount(Account(a->Id(), a->Name(), a->Placeholder(),
+          parent, a->SingleCoin(), coin));
+      parent->AddChild(accnt);
+    }
+  }
+
+  // add the transactions and splits in the order they were added to the other
+  // file to keep the order of transactions with the same date
+  for (auto& txn : other.transaction_list_) {
+    if (transactions_.count(txn->Id()) > 0)
+      throw std::invalid_argument("Transaction " + txn->Id().ToString() +
+                                  " is already in the file");
+    AddTransaction(Transaction(
+        txn->Id(), txn->Date(), txn->Description(), txn->Import_id()));
+  }
+  for (auto& s : other.split_list_) {
+    if (splits_.count(s->Id()) > 0)
+      throw std::invalid_argument(
+          "Split " + s->Id().ToString() + " is already in the file");
+    AddSplit(Split(s->Id(), transactions_.at(s->GetTransaction()->Id()),
+        accounts_.at(s->GetAccount()->Id()), s->Memo(), s->GetAmount(),
+        coins_.at(s->GetCoin()->Id()), s->Import_id()));
+  }
+}
+
+void File::RenameAccount(
+    std::shared_ptr<Account> account, const std::string& name) {
+  if (account->Name() == name) return;
+  if (GetAccount(account->Parent(), name) != nullptr)
+    throw std::invalid_argument("Account '" +
+                                Account::MakeFullName(account->Parent(), name) +
+                                "' already exists");
+
+  // re-insert the account into its parent's children to keep them sorted
+  account_trie_.Detach(account);
+  auto parent = account->Parent();
+  if (parent != nullptr) accounts_.at(parent->Id())->RemoveChild(account);
+  account->SetName(name);
+  if (parent != nullptr) accounts_.at(parent->Id())->AddChild(account);
+  account_trie_.Attach(account);
+}
+
+void File::MoveAccount(
+    std::shared_ptr<Account> account, std::shared_ptr<Account> new_parent) {
+  if (new_parent->IsContainedIn(account))
+    throw std::invalid_argument("Cannot move account " + account->FullName() +
+                                " into its own sub account " +
+                                new_parent->FullName());
+
+  if (GetAccount(new_parent, account->Name()) != nullptr)
+    throw std::invalid_argument(
+        "Account '" +
+        Account::MakeFullName(new_parent, account->Name()) +
+        "' already exists");
+
+  account_trie_.Detach(account);
+  if (account->Parent() != nullptr)
+    accounts_.at(account->Parent()->Id())->RemoveChild(account);
+
+  // move the total balance of the account from the old to the new parents
+  const auto& total = subtree_balances_[account->Index()];
+  for (auto a = account->Parent(); a != nullptr; a = a->Parent()) {
+    auto& parent_total = subtree_balances_[a->Index()];
+    for (size_t c = 0; c < total.size(); ++c) parent_total[c] -= total[c];
+  }
+  for (std::shared_ptr<const Account> a = new_parent; a != nullptr;
+       a = a->Parent()) {
+    auto& parent_total = subtree_balances_[a->Index()];
+    if (parent_total.size() < total.size()) parent_total.resize(total.size());
+    for (size_t c = 0; c < total.size(); ++c) parent_total[c] += total[c];
+  }
+
+  account->SetParent(new_parent);
+  new_parent->AddChild(account);
+  account_trie_.Attach(account);
+}
+
 void File::BalanceTransaction(
     const std::string& txn_import_id, std::shared_ptr<const Account> account) {
   // first check that the transaction exists, that it is unbalanced, and that it
@@ -629,12 +991,8 @@ void File::BalanceTransaction(
     throw std::invalid_argument(
         "Cannot balance the multi-coin transaction " + txn_import_id);
 
-  Amount total = 0;
-  for (auto& sp : txn->Splits()) total += sp->GetAmount();
-
-  auto split = Split::Create(
-      this, txn, account, "", -total, coin, "auto_balance_" + txn_import_id);
-  txn->AddSplit(split);
+  Split::Create(this, txn, account, "", -txn->Total(), coin,
+      "auto_balance_" + txn_import_id);
 }
 
 void File::PrintAccountTree() const {
@@ -646,40 +1004,149 @@ void File::PrintAccountTree() const {
 }
 
 void File::PrintTransactions() const {
-  std::vector<std::shared_ptr<Transaction>> txns;
-  for (auto& e : transactions_) txns.push_back(e.second);
-  PrintTransactions(txns, true);
+  for (auto& e : transactions_by_date_) e.second->Print(true);
 }
 
 void File::PrintUnbalancedTransactions() const {
   std::vector<std::shared_ptr<Transaction>> txns;
-  for (auto& e : transactions_) {
-    if (!e.second->Balanced()) txns.push_back(e.second);
-  }
+  for (auto& e : unbalanced_transactions_) txns.push_back(e.second);
   PrintTransactions(txns, true);
 }
 
 void File::PrintUnmatchedTransactions() const {
   std::vector<std::shared_ptr<Transaction>> txns;
-  for (auto& e : transactions_) {
-    if (!e.second->Matched()) txns.push_back(e.second);
-  }
+  for (auto& e : unmatched_transactions_) txns.push_back(e.second);
   PrintTransactions(txns, true);
 }
 
 UUIDMap<Balance> File::MakeAccountBalances() const {
   UUIDMap<Balance> balances;
 
-  for (auto& a : accounts_) balances.insert({{a.first, Balance()}});
+  for (auto& a : account_list_)
+    balances.insert({{a->Id(), MakeBalance(balances_[a->Index()])}});
+
+  return balances;
+}
+
+UUIDMap<Balance> File::SumAccountBalances(size_t num_threads) const {
+  size_t num_accounts = account_list_.size();
+  size_t num_coins = coin_list_.size();
+
+  // every thread sums its splits into its own flat array of per-account,
+  // per-coin amounts, the shared_ptrs are only dereferenced and never copied
+  // so that the threads don't contend on the reference counts
+  std::vector<std::vector<Amount>> partials(NumThreads(num_threads));
+  size_t num_chunks = ParallelChunks(split_list_.size(), num_threads,
+      [&](size_t chunk, size_t begin, size_t end) {
+        auto& partial = partials[chunk];
+        partial.resize(num_accounts * num_coins);
+        for (size_t i = begin; i < end; ++i) {
+          auto& s = *split_list_[i];
+          partial[s.account_->Index() * num_coins + s.coin_->Index()] +=
+              s.amount_;
+        }
+      });
+
+  std::vector<Amount> sums(num_accounts * num_coins);
+  for (size_t c = 0; c < num_chunks; ++c) {
+    for (size_t i = 0; i < partials[c].size(); ++i) sums[i] += partials[c][i];
+  }
 
-  for (auto& s : splits_)
-    balances[s.second->GetAccount()->Id()].AddSplit(s.second);
+  UUIDMap<Balance> balances;
+  for (auto& a : account_list_) {
+    auto begin = sums.begin() + a->Index() * num_coins;
+    balances.insert({{a->Id(),
+        MakeBalance(std::vector<Amount>(begin, begin + num_coins))}});
+  }
 
   return balances;
 }
 
+Balance File::GetBalance(
+    std::shared_ptr<const Account> account, bool include_sub_accounts) const {
+  return MakeBalance((include_sub_accounts ? subtree_balances_
+                                           : balances_)[account->Index()]);
+}
+
+Balance File::BalanceAt(std::shared_ptr<const Account> account, Datetime date,
+    bool include_sub_accounts) const {
+  return MakeBalance(TimelinesAt(account, include_sub_accounts, date));
+}
+
+Balance File::BalanceChange(std::shared_ptr<const Account> account,
+    Datetime from, Datetime to, bool include_sub_accounts) const {
+  auto amounts = TimelinesAt(account, include_sub_accounts, to);
+  auto before = TimelinesAt(account, include_sub_accounts, from);
+  for (size_t c = 0; c < amounts.size(); ++c) amounts[c] -= before[c];
+
+  return MakeBalance(amounts);
+}
+
+BalanceHistory File::MakeBalanceHistory(
+    std::shared_ptr<const Account> account, bool include_sub_accounts) const {
+  if (transactions_by_date_.size() == 0)
+    return MakeBalanceHistory(
+        account, Datetime::Now(), Datetime::Now(), include_sub_accounts);
+
+  return MakeBalanceHistory(account, transactions_by_date_.begin()->first,
+      transactions_by_date_.rbegin()->first, include_sub_accounts);
+}
+
+BalanceHistory File::MakeBalanceHistory(std::shared_ptr<const Account> account,
+    Datetime from, Datetime to, bool include_sub_accounts) const {
+  auto accounts = SubtreeAccounts(account);
+  return BalanceHistory(transactions_by_date_, accounts, from.DailyDataDay(),
+      to.DailyDataDay(), include_sub_accounts);
+}
+
+PeriodSummary File::MakePeriodSummary(
+    Period period, std::shared_ptr<const Account> account) const {
+  if (transactions_by_date_.size() == 0)
+    return MakePeriodSummary(period, account, Datetime::Now(), Datetime::Now());
+
+  return MakePeriodSummary(period, account,
+      transactions_by_date_.begin()->first,
+      transactions_by_date_.rbegin()->first);
+}
+
+PeriodSummary File::MakePeriodSummary(Period period,
+    std::shared_ptr<const Account> account, Datetime from, Datetime to) const {
+  std::vector<std::shared_ptr<const Coin>> coins(
+      coin_list_.begin(), coin_list_.end());
+
+  return PeriodSummary(transactions_by_date_, SubtreeAccounts(account), coins,
+      from.DailyDataDay(), to.DailyDataDay(), period);
+}
+
+ValuationHistory File::MakeValuationHistory(
+    std::shared_ptr<const Account> account) const {
+  if (transactions_by_date_.size() == 0)
+    return MakeValuationHistory(account, Datetime::Now(), Datetime::Now());
+
+  return MakeValuationHistory(account, transactions_by_date_.begin()->first,
+      transactions_by_date_.rbegin()->first);
+}
+
+ValuationHistory File::MakeValuationHistory(
+    std::shared_ptr<const Account> account, Datetime from, Datetime to) const {
+  auto holdings = MakeBalanceHistory(account, from, to, true);
+  auto prices = PrefetchUSDPrices(
+      holdings.Coins(), holdings.FirstDay(), holdings.LastDay());
+  return ValuationHistory(holdings, prices);
+}
+
+BalanceRollup File::MakeBalanceRollup() const {
+  auto top_level = account_trie_.TopLevel();
+  std::vector<std::shared_ptr<const Account>> roots(
+      top_level.begin(), top_level.end());
+  std::vector<std::shared_ptr<const Coin>> coins(
+      coin_list_.begin(), coin_list_.end());
+
+  return BalanceRollup(roots, coins, balances_);
+}
+
 void File::PrintAccountBalances(bool fetch_usd_prices) const {
-  auto balances = MakeAccountBalances();
+  auto rollup = MakeBalanceRollup();
 
   std::unordered_map<std::string, Amount> prices;
 
@@ -689,11 +1156,11 @@ void File::PrintAccountBalances(bool fetch_usd_prices) const {
     for (const auto& c : coins_) prices.insert({c.second->Id(), Amount(0)});
   }
 
-  GetAccount("Assets")->PrintTreeBalance(balances, "", false, &prices);
-  GetAccount("Equity")->PrintTreeBalance(balances, "", true, &prices);
-  GetAccount("Expenses")->PrintTreeBalance(balances, "", false, &prices);
-  GetAccount("Income")->PrintTreeBalance(balances, "", true, &prices);
-  GetAccount("Liabilities")->PrintTreeBalance(balances, "", true, &prices);
+  rollup.Print(GetAccount("Assets"), false, &prices);
+  rollup.Print(GetAccount("Equity"), true, &prices);
+  rollup.Print(GetAccount("Expenses"), false, &prices);
+  rollup.Print(GetAccount("Income"), true, &prices);
+  rollup.Print(GetAccount("Liabilities"), true, &prices);
 }
 
 Amount File::GetHistoricUSDPrice(
@@ -704,6 +1171,70 @@ Amount File::GetHistoricUSDPrice(
   return daily_data_.at(coin->Id())(time);
 }
 
+bool File::FindHistoricUSDPrice(
+    Datetime time, std::shared_ptr<const Coin> coin, Amount* price) const {
+  if (coin->IsUSD()) {
+    *price = 1;
+    return true;
+  }
+
+  auto itm = daily_data_.find(coin->Id());
+  if (itm == daily_data_.end()) return false;
+  return itm->second.Find(time, price);
+}
+
+std::vector<std::vector<double>> File::PrefetchUSDPrices(
+    const std::vector<std::shared_ptr<const Coin>>& coins, int64_t from,
+    int64_t to) const {
+  std::vector<std::vector<double>> prices;
+  prices.reserve(coins.size());
+
+  for (auto& coin : coins) {
+    if (coin->IsUSD()) {
+      prices.push_back(std::vector<double>(to - from + 1, 1.0));
+      continue;
+    }
+
+    if (daily_data_.count(coin->Id()) == 0)
+      daily_data_.insert({{coin->Id(), DailyData(coin)}});
+    auto& daily_data = daily_data_.at(coin->Id());
+    daily_data.Prefetch(from, to);
+    prices.push_back(daily_data.PricesAsDouble(from, to));
+  }
+
+  return prices;
+}
+
+void File::PrefetchUSDPrices(
+    const std::vector<std::shared_ptr<const Coin>>& coins,
+    const std::vector<std::pair<int64_t, int64_t>>& days,
+    size_t num_threads) const {
+  if (coins.size() != days.size())
+    throw std::invalid_argument("Need the days of every coin to prefetch");
+
+  // the DailyData of each coin is only touched by the thread fetching that
+  // coin, so all DailyData have to exist before the threads start
+  std::vector<DailyData*> daily_data;
+  for (auto& coin : coins) {
+    if (coin->IsUSD()) {
+      daily_data.push_back(nullptr);
+      continue;
+    }
+
+    if (daily_data_.count(coin->Id()) == 0)
+      daily_data_.insert({{coin->Id(), DailyData(coin)}});
+    daily_data.push_back(&daily_data_.at(coin->Id()));
+  }
+
+  std::atomic<size_t> num_done(0);
+  ParallelFor(coins.size(), num_threads, [&](size_t c) {
+    if (daily_data[c] != nullptr)
+      daily_data[c]->Prefetch(days[c].first, days[c].second);
+    printf("Fetched prices of %s (%zu/%zu)\n", coins[c]->Id().c_str(),
+        ++num_done, coins.size());
+  });
+}
+
 void File::AddCoinNumIds() {
   auto num_ids = PriceSource::GetNumIds();
   for (auto& c : coins_) {
@@ -712,9 +1243,121 @@ void File::AddCoinNumIds() {
   }
 }
 
+std::shared_ptr<Account> File::GetAccountOrThrow(
+    const std::string& fullname) const {
+  auto res = account_trie_.Find(fullname);
+  if (res == nullptr)
+    throw std::out_of_range("There is no account '" + fullname + "'");
+  return res;
+}
+
+std::vector<std::shared_ptr<const Account>> File::SubtreeAccounts(
+    std::shared_ptr<const Account> account) const {
+  std::vector<std::shared_ptr<const Account>> accounts;
+  if (account != nullptr) {
+    auto sub = account_trie_.Subtree(account->FullName());
+    accounts.assign(sub.begin(), sub.end());
+  } else {
+    for (auto& a : account_trie_.TopLevel()) {
+      auto sub = account_trie_.Subtree(a->FullName());
+      accounts.insert(accounts.end(), sub.begin(), sub.end());
+    }
+  }
+
+  return accounts;
+}
+
+void File::AddToBalances(std::shared_ptr<const Account> account,
+    int coin_idx, Datetime time, Amount amount) {
+  auto& own = balances_[account->Index()];
+  if ((int)own.size() <= coin_idx) own.resize(coin_idx + 1);
+  own[coin_idx] += amount;
+
+  auto& own_timelines = timelines_[account->Index()];
+  if ((int)own_timelines.size() <= coin_idx)
+    own_timelines.resize(coin_idx + 1);
+  own_timelines[coin_idx].Add(time, amount);
+
+  for (auto a = account; a != nullptr; a = a->Parent()) {
+    auto& total = subtree_balances_[a->Index()];
+    if ((int)total.size() <= coin_idx) total.resize(coin_idx + 1);
+    total[coin_idx] += amount;
+  }
+}
+
+std::vector<Amount> File::TimelinesAt(std::shared_ptr<const Account> account,
+    bool include_sub_accounts, Datetime time, int coin_idx) const {
+  std::vector<std::shared_ptr<const Account>> accounts;
+  if (include_sub_accounts)
+    accounts = SubtreeAccounts(account);
+  else
+    accounts.push_back(account);
+
+  std::vector<Amount> amounts(coin_idx + 1);
+  for (auto& a : accounts) {
+    auto& timelines = timelines_[a->Index()];
+    if (coin_idx >= 0) {
+      if ((int)timelines.size() > coin_idx)
+        amounts[coin_idx] += timelines[coin_idx].At(time);
+      continue;
+    }
+
+    if (amounts.size() < timelines.size()) amounts.resize(timelines.size());
+    for (size_t c = 0; c < timelines.size(); ++c)
+      amounts[c] += timelines[c].At(time);
+  }
+
+  return amounts;
+}
+
+Balance File::MakeBalance(const std::vector<Amount>& amounts) const {
+  Balance balance;
+  for (size_t c = 0; c < amounts.size(); ++c) {
+    if (amounts[c] != 0) balance.AddAmount(amounts[c], coin_list_[c]);
+  }
+  return balance;
+}
+
+std::vector<StatementLine> File::MakeStatement(
+    MergedSplits* merged, std::vector<Amount> closing, int coin_idx) {
+  std::vector<std::shared_ptr<Split>> splits;
+  splits.reserve(merged->Size());
+  for (auto s = merged->Next(); s != nullptr; s = merged->Next()) {
+    if ((coin_idx < 0) || (s->GetCoin()->Index() == coin_idx))
+      splits.push_back(s);
+  }
+
+  // the opening balance is the closing balance minus all the splits
+  auto balances = closing;
+  for (auto& s : splits) balances[s->GetCoin()->Index()] -= s->GetAmount();
+
+  std::vector<StatementLine> lines;
+  lines.reserve(splits.size());
+  for (auto& s : splits) {
+    auto& balance = balances[s->GetCoin()->Index()];
+    balance += s->GetAmount();
+    lines.push_back({s, balance});
+  }
+
+  return lines;
+}
+
+void File::UpdateTransactionStatus(std::shared_ptr<Transaction> txn) {
+  if (txn->Balanced())
+    unbalanced_transactions_.erase(txn->Id());
+  else
+    unbalanced_transactions_.insert({{txn->Id(), txn}});
+
+  if (txn->Matched())
+    unmatched_transactions_.erase(txn->Id());
+  else
+    unmatched_transactions_.insert({{txn->Id(), txn}});
+}
+
 void File::PrintTransactions(std::vector<std::shared_ptr<Transaction>> txns,
     bool print_import_id) const {
-  // sort transaction by account full name
+  // sort transactions by date, this is only used for the few transactions that
+  // need fixing, all transactions are printed from the date index
   std::sort(txns.begin(), txns.end(),
       [](const std::shared_ptr<Transaction>& a,
           const std::shared_ptr<Transaction>& b) {
@@ -10,16 +10,26 @@
 #define SRC_FILE_HPP_
 
 #include <algorithm>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
 
 #include "Account.hpp"
+#include "AccountTrie.hpp"
 #include "Balance.hpp"
+#include "BalanceHistory.hpp"
+#include "BalanceRollup.hpp"
+#include "BalanceTimeline.hpp"
 #include "Coin.hpp"
+#include "PeriodSummary.hpp"
 #include "Split.hpp"
+#include "SplitPostings.hpp"
+#include "TextIndex.hpp"
 #include "Transaction.hpp"
+#include "TransactionQuery.hpp"
 #include "UUID.hpp"
+#include "ValuationHistory.hpp"
 
 #include "prices/DailyData.hpp"
 #include "prices/PriceSource.hpp"
@@ -33,7 +43,10 @@
 
 class File {
  public:
-  static File InitNewFile();
+  // create a file with the root accounts and USD, if add_all_coins is true,
+  // all the coins known to the price source are added too (this needs network
+  // access)
+  static File InitNewFile(bool add_all_coins = true);
 
   static File Open(const std::string& path);
 
@@ -46,6 +59,17 @@ class File {
   std::shared_ptr<Transaction> GetTransactionFromImportId(
       const std::string& import_id, bool fail_if_not_exist = false);
 
+  // return true if there is a split with the given import id, if txn is not
+  // nullptr, only splits belonging to txn are considered
+  bool HasSplitImportId(const std::string& import_id,
+      std::shared_ptr<const Transaction> txn = nullptr) const;
+
+  // get a split with the given import id, if there is no such split, return
+  // nullptr; if there are multiple splits with this import id, any one of them
+  // is returned
+  std::shared_ptr<Split> FindSplitByImportId(
+      const std::string& import_id) const;
+
   // balance the unbalanced, single-coin transaction identified by the import id
   // by adding a split to the given account that will balance the transaction
   void BalanceTransaction(
@@ -59,11 +83,88 @@ class File {
 
   UUIDMap<Balance> MakeAccountBalances() const;
 
+  // recompute the balances of all accounts from scratch by summing all the
+  // splits in num_threads threads (0 means one thread per core), each thread
+  // sums a contiguous chunk of the splits and the partial sums are added in
+  // chunk order, the result is the same as MakeAccountBalances
+  UUIDMap<Balance> SumAccountBalances(size_t num_threads = 0) const;
+
+  // get the current balance of the account, optionally including the balances
+  // of all its sub accounts, this does not need to loop over any splits
+  Balance GetBalance(std::shared_ptr<const Account> account,
+      bool include_sub_accounts = false) const;
+
+  // get the balance of the account, optionally including the balances of all
+  // its sub accounts, from the transactions dated at or before date
+  Balance BalanceAt(std::shared_ptr<const Account> account, Datetime date,
+      bool include_sub_accounts = false) const;
+
+  // get the change of the balance of the account, optionally including all its
+  // sub accounts, from the transactions dated after from and at or before to
+  Balance BalanceChange(std::shared_ptr<const Account> account, Datetime from,
+      Datetime to, bool include_sub_accounts = false) const;
+
+  // build the daily balance history of the account and all its sub accounts,
+  // or of all accounts if account is nullptr, from the day of the first to the
+  // day of the last transaction or from the day of from to the day of to
+  BalanceHistory MakeBalanceHistory(
+      std::shared_ptr<const Account> account = nullptr,
+      bool include_sub_accounts = false) const;
+  BalanceHistory MakeBalanceHistory(std::shared_ptr<const Account> account,
+      Datetime from, Datetime to, bool include_sub_accounts = false) const;
+
+  // compute the daily USD value of the account and all its sub accounts
+  // (including the sub accounts in each value), or of all accounts if account
+  // is nullptr, the USD prices of all coins are fetched before the values are
+  // computed
+  ValuationHistory MakeValuationHistory(
+      std::shared_ptr<const Account> account = nullptr) const;
+  ValuationHistory MakeValuationHistory(std::shared_ptr<const Account> account,
+      Datetime from, Datetime to) const;
+
+  // sum the inflows and outflows of the account and all its sub accounts, or
+  // of all accounts if account is nullptr, by calendar period from the first
+  // to the last transaction or from from to to
+  PeriodSummary MakePeriodSummary(
+      Period period, std::shared_ptr<const Account> account = nullptr) const;
+  PeriodSummary MakePeriodSummary(Period period,
+      std::shared_ptr<const Account> account, Datetime from, Datetime to) const;
+
+  // compute the own and total balances of all accounts in a single pass over
+  // the account trees
+  BalanceRollup MakeBalanceRollup() const;
+
   void PrintAccountBalances(bool fetch_usd_prices = true) const;
 
   Amount GetHistoricUSDPrice(
       Datetime time, std::shared_ptr<const Coin> coin) const;
 
+  // use the given daily prices for their coin instead of fetching them, e.g.
+  // to run the tax calculations on made up prices
+  void SetDailyData(const DailyData& data) {
+    daily_data_.erase(data.GetCoin()->Id());
+    daily_data_.insert({{data.GetCoin()->Id(), data}});
+  }
+
+  // get the USD price of the coin at time if it is available without fetching
+  // any data, return false otherwise, several threads may call this at the
+  // same time as long as no prices are fetched
+  bool FindHistoricUSDPrice(
+      Datetime time, std::shared_ptr<const Coin> coin, Amount* price) const;
+
+  // fetch the daily USD prices of the coins from day from to day to and return
+  // them as doubles, prices[c][d] is the price of coins[c] on day from + d
+  std::vector<std::vector<double>> PrefetchUSDPrices(
+      const std::vector<std::shared_ptr<const Coin>>& coins, int64_t from,
+      int64_t to) const;
+
+  // fetch the daily USD prices of coins[c] from day days[c].first to day
+  // days[c].second, the coins are fetched in up to num_threads threads (0
+  // means one thread per core) and a line is printed when a coin is done
+  void PrefetchUSDPrices(const std::vector<std::shared_ptr<const Coin>>& coins,
+      const std::vector<std::pair<int64_t, int64_t>>& days,
+      size_t num_threads) const;
+
   void AddNewCoins() { PriceSource::AddAllCoins(this, true); }
 
   void AddCoinNumIds();
@@ -103,7 +204,8 @@ class File {
     auto res =
         accounts_.emplace(account.Id(), std::make_shared<Account>(account))
             .first->second;
-    accounts_by_fullname_.insert({{account.FullName(), res}});
+    IndexAccount(res);
+    account_trie_.Attach(res);
     return res;
   }
   std::shared_ptr<Account> GetAccount(uuid_t id) { return accounts_.at(id); }
@@ -111,23 +213,53 @@ class File {
     return accounts_;
   }
 
-  const std::unordered_map<std::string, std::shared_ptr<Account>>&
-  AccountsByFullname() const {
-    return accounts_by_fullname_;
+  // get the account with the given full name (parent::parent::account), throw
+  // an exception if there is no such account
+  std::shared_ptr<Account> GetAccount(const std::string& fullname) {
+    return GetAccountOrThrow(fullname);
+  }
+  std::shared_ptr<const Account> GetAccount(const std::string& fullname) const {
+    return GetAccountOrThrow(fullname);
   }
-  std::shared_ptr<Account> GetAccount(std::string fullname) {
-    return accounts_by_fullname_.at(fullname);
+
+  // get the child of parent (or the top-level account if parent is nullptr)
+  // with the given name, return nullptr if there is no such account
+  std::shared_ptr<Account> GetAccount(
+      std::shared_ptr<const Account> parent, const std::string& name) {
+    return account_trie_.FindChild(parent, name);
   }
-  std::shared_ptr<const Account> GetAccount(std::string fullname) const {
-    return accounts_by_fullname_.at(fullname);
+  std::shared_ptr<const Account> GetAccount(
+      std::shared_ptr<const Account> parent, const std::string& name) const {
+    return account_trie_.FindChild(parent, name);
+  }
+
+  // get the account with the given full name and all the accounts under it,
+  // sorted by name within each level of the tree, return an empty list if
+  // there is no such account
+  std::vector<std::shared_ptr<Account>> GetAccountsUnder(
+      const std::string& fullname) const {
+    return account_trie_.Subtree(fullname);
   }
 
+  // rename the account, the full names of the account and all its sub
+  // accounts change accordingly, renaming to the current name does nothing
+  void RenameAccount(std::shared_ptr<Account> account, const std::string& name);
+
+  // move the account and all its sub accounts under a new parent account
+  void MoveAccount(
+      std::shared_ptr<Account> account, std::shared_ptr<Account> new_parent);
+
   std::shared_ptr<Transaction> AddTransaction(const Transaction& transaction) {
     auto res = transactions_
                    .emplace(transaction.Id(),
                        std::make_shared<Transaction>(transaction))
                    .first->second;
+    res->index_ = transaction_list_.size();
+    transaction_list_.push_back(res);
     transactions_by_import_id_.insert({{res->Import_id(), res}});
+    transactions_by_date_.insert({{res->Date(), res}});
+    text_index_.Add(res->Index(), res->Description());
+    UpdateTransactionStatus(res);
     return res;
   }
   std::shared_ptr<Transaction> GetTransaction(uuid_t id) {
@@ -141,19 +273,125 @@ class File {
     return transactions_by_import_id_;
   }
 
-  std::shared_ptr<Split> AddSplit(const Split& split) {
-    return splits_.emplace(split.Id(), std::make_shared<Split>(split))
-        .first->second;
+  // all transactions sorted by date, transactions with the same date are in
+  // the order in which they were added to the file
+  const std::multimap<Datetime, std::shared_ptr<Transaction>>&
+  TransactionsByDate() const {
+    return transactions_by_date_;
+  }
+
+  // find the transactions whose description or split memos contain words
+  // matching all the words in text, sorted by date
+  std::vector<std::shared_ptr<Transaction>> SearchText(const std::string& text,
+      TextIndex::Match match = TextIndex::Match::Substring) const;
+
+  // find the transactions matching the query in date order, the candidate
+  // transactions come from the index that is expected to yield the fewest of
+  // them and are only read as the cursor advances
+  TransactionCursor Query(const TransactionQuery& query) const;
+
+  // the splits in the account itself and the splits in the coin, sorted by
+  // the date of their transactions
+  const SplitPostings& AccountPostings(
+      std::shared_ptr<const Account> account) const {
+    return account_postings_[account->Index()];
+  }
+  const SplitPostings& CoinPostings(std::shared_ptr<const Coin> coin) const;
+
+  // the splits in the account, optionally including all its sub accounts,
+  // with from <= date <= to sorted by date, each with the balance of the
+  // account in the coin of the split after the split
+  std::vector<StatementLine> AccountStatement(
+      std::shared_ptr<const Account> account, Datetime from, Datetime to,
+      bool include_sub_accounts = false) const;
+
+  // the splits in the coin with from <= date <= to sorted by date, each with
+  // the total balance in the coin of all accounts after the split, or of the
+  // account and all its sub accounts if account is not nullptr (then only the
+  // splits in these accounts are included)
+  std::vector<StatementLine> CoinHistory(std::shared_ptr<const Coin> coin,
+      Datetime from, Datetime to,
+      std::shared_ptr<const Account> account = nullptr) const;
+
+  // get all transactions with from <= date <= to sorted by date, none if to is
+  // before from
+  std::vector<std::shared_ptr<Transaction>> TransactionsBetween(
+      Datetime from, Datetime to) const;
+
+  // transactions that are not balanced (this includes all unmatched
+  // transactions) and transactions that are not matched
+  const UUIDMap<std::shared_ptr<Transaction>>& UnbalancedTransactions() const {
+    return unbalanced_transactions_;
   }
+  const UUIDMap<std::shared_ptr<Transaction>>& UnmatchedTransactions() const {
+    return unmatched_transactions_;
+  }
+
+  // change the date of the transaction and move it to its new place in the
+  // date index
+  void SetTransactionDate(std::shared_ptr<Transaction> txn, Datetime date);
+
+  // add the split to the file and to its transaction
+  std::shared_ptr<Split> AddSplit(const Split& split);
   std::shared_ptr<Split> GetSplit(uuid_t id) { return splits_.at(id); }
   const UUIDMap<std::shared_ptr<Split>>& Splits() const { return splits_; }
 
  private:
+  friend class FederatedFile;
+
   File() {}
 
+  // copy all coins, prices, accounts, transactions, and splits of the other
+  // file into this file, the top-level accounts of the other file are put
+  // under a new top-level account with the given name, coins are identified
+  // by their id and the first definition of a coin is kept, throw an exception
+  // if an account, transaction, or split id already exists in this file
+  void AddFileUnder(const File& other, const std::string& name);
+
   void PrintTransactions(std::vector<std::shared_ptr<Transaction>> txns,
       bool print_import_id = false) const;
 
+  std::shared_ptr<Account> GetAccountOrThrow(const std::string& fullname) const;
+
+  // the account and all accounts under it in depth-first order, or all
+  // accounts if account is nullptr
+  std::vector<std::shared_ptr<const Account>> SubtreeAccounts(
+      std::shared_ptr<const Account> account) const;
+
+  // assign the next dense index to the account
+  void IndexAccount(std::shared_ptr<Account> account) {
+    account->index_ = account_list_.size();
+    account_list_.push_back(account);
+    balances_.emplace_back();
+    subtree_balances_.emplace_back();
+    timelines_.emplace_back();
+    account_postings_.emplace_back();
+  }
+
+  // add amount in the coin with index coin_idx at the given time to the
+  // timeline of the account and to the balances of the account and all its
+  // parent accounts
+  void AddToBalances(std::shared_ptr<const Account> account, int coin_idx,
+      Datetime time, Amount amount);
+
+  // the balance by coin index of the account, optionally including all its
+  // sub accounts (all accounts if account is nullptr), from the amounts dated
+  // at or before time, if coin_idx is not negative only that coin is summed
+  std::vector<Amount> TimelinesAt(std::shared_ptr<const Account> account,
+      bool include_sub_accounts, Datetime time, int coin_idx = -1) const;
+
+  Balance MakeBalance(const std::vector<Amount>& amounts) const;
+
+  // the statement lines of the merged splits, closing is the balance by coin
+  // index after the last split, if coin_idx is not negative only the splits
+  // in the coin with that index are included
+  static std::vector<StatementLine> MakeStatement(MergedSplits* merged,
+      std::vector<Amount> closing, int coin_idx = -1);
+
+  // add or remove the transaction from the sets of unbalanced and unmatched
+  // transactions
+  void UpdateTransactionStatus(std::shared_ptr<Transaction> txn);
+
   // all the known coins
   std::unordered_map<std::string, std::shared_ptr<Coin>> coins_;
   // coin symbols are mostly unique, but not always
@@ -165,9 +403,30 @@ class File {
   // all accounts
   UUIDMap<std::shared_ptr<Account>> accounts_;
 
-  // map of full account names (parent::parent::account) vs. account id
-  std::unordered_map<std::string, std::shared_ptr<Account>>
-      accounts_by_fullname_;
+  // trie of the full account names (parent::parent::account)
+  AccountTrie account_trie_;
+
+  // all accounts by their index
+  std::vector<std::shared_ptr<Account>> account_list_;
+
+  // the coins used in splits by their index
+  std::vector<std::shared_ptr<Coin>> coin_list_;
+
+  // running balances of all accounts by account and coin index, balances_ only
+  // contains the splits in the account itself, subtree_balances_ also
+  // contains the splits of all sub accounts, the inner vectors only extend up
+  // to the largest coin index used in the account
+  std::vector<std::vector<Amount>> balances_;
+  std::vector<std::vector<Amount>> subtree_balances_;
+
+  // the balances over time by account and coin index, only of the splits in
+  // the account itself, the balance of a subtree at a time is the sum of the
+  // timelines of its accounts
+  std::vector<std::vector<BalanceTimeline>> timelines_;
+
+  // the splits by account and coin index, sorted by date
+  std::vector<SplitPostings> account_postings_;
+  std::vector<SplitPostings> coin_postings_;
 
   // all transactions
   UUIDMap<std::shared_ptr<Transaction>> transactions_;
@@ -176,8 +435,29 @@ class File {
   std::unordered_multimap<std::string, std::shared_ptr<Transaction>>
       transactions_by_import_id_;
 
+  // transactions by date
+  std::multimap<Datetime, std::shared_ptr<Transaction>> transactions_by_date_;
+
+  // all transactions by their index
+  std::vector<std::shared_ptr<Transaction>> transaction_list_;
+
+  // index of the words in the descriptions and split memos by transaction
+  // index
+  TextIndex text_index_;
+
+  // transactions that still need to be fixed
+  UUIDMap<std::shared_ptr<Transaction>> unbalanced_transactions_;
+  UUIDMap<std::shared_ptr<Transaction>> unmatched_transactions_;
+
   // all std::shared_ptrlits
   UUIDMap<std::shared_ptr<Split>> splits_;
+
+  // all splits in the order they were added, for splitting them into chunks
+  std::vector<std::shared_ptr<Split>> split_list_;
+
+  // splits by import id, splits without import id are not included
+  std::unordered_multimap<std::string, std::shared_ptr<Split>>
+      splits_by_import_id_;
 };
 
 #endif  // SRC_FILE_HPP_
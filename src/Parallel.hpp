@@ -0,0 +1,87 @@
+/// \file Parallel.hpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#ifndef SRC_PARALLEL_HPP_
+#define SRC_PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// the number of threads to use if num_threads is 0
+inline size_t NumThreads(size_t num_threads = 0) {
+  if (num_threads > 0) return num_threads;
+  return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+// split [0, n) into num_threads contiguous chunks (fewer if n is small) and
+// call body(thread_idx, begin, end) for each chunk in its own thread, chunk
+// thread_idx always covers the same range for the same n and num_threads so
+// that per-thread results can be combined in a deterministic order, returns
+// the number of chunks, if any call throws, the first exception (by
+// thread_idx) is rethrown after all threads have finished
+template <typename F>
+size_t ParallelChunks(size_t n, size_t num_threads, F body) {
+  size_t num_chunks = std::max<size_t>(std::min(NumThreads(num_threads), n), 1);
+
+  std::vector<std::exception_ptr> errors(num_chunks);
+  auto run = [&](size_t i) {
+    try {
+      body(i, n * i / num_chunks, n * (i + 1) / num_chunks);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  };
+
+  // run the first chunk in this thread
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_chunks; ++i) threads.emplace_back(run, i);
+  run(0);
+  for (auto& t : threads) t.join();
+
+  for (auto& e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+
+  return num_chunks;
+}
+
+// call body(i) for every i in [0, n) in up to num_threads threads, each thread
+// takes the next i when it is done with its previous one, so that tasks of
+// very different sizes are balanced, if any call throws, the exception of the
+// smallest i is rethrown after all threads have finished
+template <typename F>
+void ParallelFor(size_t n, size_t num_threads, F body) {
+  size_t num = std::max<size_t>(std::min(NumThreads(num_threads), n), 1);
+
+  std::vector<std::exception_ptr> errors(n);
+  std::atomic<size_t> next(0);
+  auto run = [&]() {
+    for (size_t i = next++; i < n; i = next++) {
+      try {
+        body(i);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+
+  // run one of the workers in this thread
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < num; ++t) threads.emplace_back(run);
+  run();
+  for (auto& t : threads) t.join();
+
+  for (auto& e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+}
+
+#endif  // SRC_PARALLEL_HPP_
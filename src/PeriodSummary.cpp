@@ -0,0 +1,154 @@
+/// \file PeriodSummary.cpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#include "PeriodSummary.hpp"
+
+#include <algorithm>
+
+PeriodSummary::PeriodSummary(
+    const std::multimap<Datetime, std::shared_ptr<Transaction>>&
+        transactions_by_date,
+    const std::vector<std::shared_ptr<const Account>>& accounts,
+    const std::vector<std::shared_ptr<const Coin>>& coins, int64_t first_day,
+    int64_t last_day, Period period)
+    : period_(period), accounts_(accounts), coins_(coins) {
+  if (last_day < first_day)
+    throw std::invalid_argument("PeriodSummary: last day is before first day");
+
+  // the table of the period of every day, the periods are numbered
+  // consecutively from the period of the first day
+  auto key = [period](int year, int month) {
+    switch (period) {
+    case Period::Month:
+      return year * 12 + (month - 1);
+    case Period::Quarter:
+      return year * 4 + (month - 1) / 3;
+    default:
+      return year;
+    }
+  };
+
+  std::vector<uint32_t> period_of_day(last_day - first_day + 1);
+  int first_key = 0;
+  for (int64_t d = first_day; d <= last_day; ++d) {
+    int year, month, day_of_month;
+    Datetime::CivilFromDay(d, &year, &month, &day_of_month);
+    int k = key(year, month);
+
+    if (d == first_day) first_key = k;
+    if ((d == first_day) || ((size_t)(k - first_key) == period_names_.size())) {
+      char name[32];
+      if (period == Period::Month)
+        snprintf(name, sizeof(name), "%04d-%02d", year, month);
+      else if (period == Period::Quarter)
+        snprintf(name, sizeof(name), "%04d-Q%d", year, (month - 1) / 3 + 1);
+      else
+        snprintf(name, sizeof(name), "%04d", year);
+
+      period_names_.push_back(name);
+      period_first_days_.push_back(d);
+    }
+
+    period_of_day[d - first_day] = k - first_key;
+  }
+
+  // position in accounts_ by the account's index in the file and the positions
+  // of the accounts whose totals an amount in an account goes into
+  std::vector<int> account_pos_by_index;
+  for (size_t i = 0; i < accounts_.size(); ++i) {
+    account_pos_.insert({{accounts_[i]->Id(), i}});
+
+    size_t idx = accounts_[i]->Index();
+    if (account_pos_by_index.size() <= idx)
+      account_pos_by_index.resize(idx + 1, -1);
+    account_pos_by_index[idx] = i;
+  }
+
+  std::vector<std::vector<size_t>> targets(accounts_.size());
+  for (size_t i = 0; i < accounts_.size(); ++i) {
+    for (auto a = accounts_[i]; a != nullptr; a = a->Parent()) {
+      auto it = account_pos_.find(a->Id());
+      if (it != account_pos_.end()) targets[i].push_back(it->second);
+    }
+  }
+
+  flows_.resize(accounts_.size());
+
+  auto begin = transactions_by_date.lower_bound(
+      Datetime::FromUNIXTimestamp(first_day * 24 * 3600));
+  auto end = transactions_by_date.lower_bound(
+      Datetime::FromUNIXTimestamp((last_day + 1) * 24 * 3600));
+  for (auto it = begin; it != end; ++it) {
+    size_t p = period_of_day[it->second->Date().DailyDataDay() - first_day];
+
+    for (auto& s : it->second->Splits()) {
+      size_t acc_idx = s->GetAccount()->Index();
+      if ((acc_idx >= account_pos_by_index.size()) ||
+          (account_pos_by_index[acc_idx] < 0))
+        continue;
+
+      size_t c = s->GetCoin()->Index();
+      if (c >= coins_.size())
+        throw std::invalid_argument("PeriodSummary: coin " +
+                                    s->GetCoin()->Id() + " is not in coins");
+
+      Amount amt = s->GetAmount();
+      for (size_t t : targets[account_pos_by_index[acc_idx]]) {
+        auto& periods = flows_[t][c];
+        if (periods.size() == 0) periods.resize(NumPeriods());
+
+        auto& flows = periods[p];
+        if (amt > 0)
+          flows.inflow += amt;
+        else
+          flows.outflow -= amt;
+      }
+    }
+  }
+}
+
+const PeriodFlows& PeriodSummary::Get(size_t period,
+    std::shared_ptr<const Account> account,
+    std::shared_ptr<const Coin> coin) const {
+  if (period >= NumPeriods())
+    throw std::out_of_range("PeriodSummary: no period " +
+                            std::to_string(period));
+
+  size_t c = coin->Index();
+  if ((c >= coins_.size()) || (coins_[c] != coin)) return empty_;
+
+  auto& flows = flows_[account_pos_.at(account->Id())];
+  auto it = flows.find(c);
+  if (it == flows.end()) return empty_;
+  return it->second[period];
+}
+
+void PeriodSummary::Print(std::shared_ptr<const Account> account) const {
+  size_t pos = account_pos_.at(account->Id());
+  printf("%s\n", account->FullName().c_str());
+
+  // sort the coins of the account by symbol
+  auto& account_flows = flows_[pos];
+  std::vector<size_t> coins;
+  for (auto& it : account_flows) coins.push_back(it.first);
+  std::sort(coins.begin(), coins.end(), [this](size_t a, size_t b) {
+    return coins_[a]->Symbol() < coins_[b]->Symbol();
+  });
+
+  for (size_t p = 0; p < NumPeriods(); ++p) {
+    for (size_t c : coins) {
+      auto& flows = account_flows.at(c)[p];
+      if (flows.Volume() == 0) continue;
+
+      printf("  %-8s %5s in %28s out %28s net %28s\n",
+          period_names_[p].c_str(), coins_[c]->Symbol().c_str(),
+          flows.inflow.ToStr().c_str(), flows.outflow.ToStr().c_str(),
+          flows.Net().ToStr().c_str());
+    }
+  }
+}
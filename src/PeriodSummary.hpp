@@ -0,0 +1,105 @@
+/// \file PeriodSummary.hpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#ifndef SRC_PERIODSUMMARY_HPP_
+#define SRC_PERIODSUMMARY_HPP_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Account.hpp"
+#include "Amount.hpp"
+#include "Coin.hpp"
+#include "Datetime.hpp"
+#include "Transaction.hpp"
+#include "UUID.hpp"
+
+enum class Period { Month, Quarter, Year };
+
+// the amounts that went into and out of an account in one period, the outflow
+// is positive, so the income of an Income account is its outflow and the
+// expense of an Expenses account is its inflow
+struct PeriodFlows {
+  Amount inflow;
+  Amount outflow;
+
+  Amount Net() const { return inflow - outflow; }
+  Amount Volume() const { return inflow + outflow; }
+};
+
+// The inflows and outflows of a set of accounts (each including its sub
+// accounts that are in the set) in every coin, bucketed by calendar periods
+// (UTC months, quarters, or years).
+//
+// The period of every day is looked up in a table that is computed once for
+// the whole range of days, and all the periods are filled in one sweep over
+// the transactions sorted by date. Only the accounts and coins that have splits
+// get flows, since most accounts only use one or two coins.
+
+class PeriodSummary {
+ public:
+  // sweep over the transactions (which must be sorted by date) from first_day
+  // to last_day (as in DailyData), coins must contain all coins used by the
+  // accounts at their Index()
+  PeriodSummary(const std::multimap<Datetime,
+                    std::shared_ptr<Transaction>>& transactions_by_date,
+      const std::vector<std::shared_ptr<const Account>>& accounts,
+      const std::vector<std::shared_ptr<const Coin>>& coins, int64_t first_day,
+      int64_t last_day, Period period);
+
+  Period GetPeriod() const { return period_; }
+
+  // the periods are numbered from 0 to NumPeriods() - 1, the first and last
+  // period may only be partially covered by the range of days
+  size_t NumPeriods() const { return period_names_.size(); }
+
+  // the name of the period, e.g. 2021-03, 2021-Q1, or 2021
+  const std::string& PeriodName(size_t period) const {
+    return period_names_.at(period);
+  }
+
+  // the first day of the period that is in the range of days
+  int64_t PeriodFirstDay(size_t period) const {
+    return period_first_days_.at(period);
+  }
+
+  const std::vector<std::shared_ptr<const Account>>& Accounts() const {
+    return accounts_;
+  }
+  const std::vector<std::shared_ptr<const Coin>>& Coins() const {
+    return coins_;
+  }
+
+  // the flows of the account and its sub accounts in the coin in the period
+  const PeriodFlows& Get(size_t period, std::shared_ptr<const Account> account,
+      std::shared_ptr<const Coin> coin) const;
+
+  void Print(std::shared_ptr<const Account> account) const;
+
+ private:
+  Period period_;
+
+  std::vector<std::string> period_names_;
+  std::vector<int64_t> period_first_days_;
+
+  std::vector<std::shared_ptr<const Account>> accounts_;
+  std::vector<std::shared_ptr<const Coin>> coins_;
+
+  UUIDMap<size_t> account_pos_;
+
+  // the flows of all periods by the coin index for each account in accounts_,
+  // only for the coins that the account or its sub accounts have splits in
+  std::vector<std::map<size_t, std::vector<PeriodFlows>>> flows_;
+
+  // returned for coins that don't appear in the summary
+  PeriodFlows empty_;
+};
+
+#endif  // SRC_PERIODSUMMARY_HPP_
@@ -0,0 +1,51 @@
+/// \file SQLite.hpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#ifndef SRC_SQLITE_HPP_
+#define SRC_SQLITE_HPP_
+
+#include <cstdio>
+#include <string>
+
+#include <sqlite3.h>
+
+// convenience macros for sqlite3 calls, the user must define SQL3_FAIL, which
+// is executed after the error has been printed
+#define SQL3(db, COMMAND)                                         \
+  if ((COMMAND) != SQLITE_OK) {                                   \
+    printf("ERROR: SQL error at %s:%i: %s\n", __FILE__, __LINE__, \
+        sqlite3_errmsg(db));                                      \
+    { SQL3_FAIL; }                                                \
+  }
+
+#define SQL3_EXEC(db, sql, callback, callback_arg)                           \
+  {                                                                          \
+    char* error_msg = nullptr;                                               \
+    if (sqlite3_exec(db, sql, callback, callback_arg, &error_msg) !=         \
+        SQLITE_OK) {                                                         \
+      printf(                                                                \
+          "ERROR: SQL error at %s:%i: %s\n", __FILE__, __LINE__, error_msg); \
+      sqlite3_free(error_msg);                                               \
+      { SQL3_FAIL; }                                                         \
+    }                                                                        \
+  }
+
+inline int sqlite3_bind_str(
+    sqlite3_stmt* stmt, int pos, const std::string& str) {
+  return sqlite3_bind_text(stmt, pos, str.c_str(), -1, SQLITE_TRANSIENT);
+}
+
+inline std::string sqlite3_column_str(sqlite3_stmt* stmt, int iCol) {
+  const unsigned char* ptr = sqlite3_column_text(stmt, iCol);
+  if (ptr == nullptr)
+    return "";
+  else
+    return std::string((const char*)ptr);
+}
+
+#endif  // SRC_SQLITE_HPP_
@@ -0,0 +1,121 @@
+/// \file SplitPostings.cpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#include "SplitPostings.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace {
+
+Datetime DateOf(const std::shared_ptr<Split>& split) {
+  return split->GetTransaction()->Date();
+}
+
+bool Before(const std::shared_ptr<Split>& a, const std::shared_ptr<Split>& b) {
+  return DateOf(a) < DateOf(b);
+}
+
+}  // namespace
+
+void SplitPostings::Add(std::shared_ptr<Split> split) {
+  std::vector<std::shared_ptr<Split>> run(1, split);
+
+  while ((runs_.size() > 0) && (runs_.back().size() <= run.size())) {
+    auto& last = runs_.back();
+    std::vector<std::shared_ptr<Split>> merged(last.size() + run.size());
+    std::merge(std::make_move_iterator(last.begin()),
+        std::make_move_iterator(last.end()),
+        std::make_move_iterator(run.begin()),
+        std::make_move_iterator(run.end()), merged.begin(), Before);
+    run = std::move(merged);
+    runs_.pop_back();
+  }
+
+  runs_.push_back(std::move(run));
+  ++size_;
+}
+
+void SplitPostings::Remove(const std::shared_ptr<Split>& split) {
+  for (size_t r = 0; r < runs_.size(); ++r) {
+    auto& run = runs_[r];
+    auto range = std::equal_range(run.begin(), run.end(), split, Before);
+    auto it = std::find(range.first, range.second, split);
+    if (it == range.second) continue;
+
+    run.erase(it);
+    if (run.size() == 0) runs_.erase(runs_.begin() + r);
+    --size_;
+    return;
+  }
+}
+
+std::vector<std::shared_ptr<Split>> SplitPostings::Splits() const {
+  std::vector<std::shared_ptr<Split>> splits;
+  splits.reserve(size_);
+
+  MergedSplits merged({this}, Datetime::Earliest(),
+      Datetime::FromUNIXTimestamp(std::numeric_limits<time_t>::max()));
+  for (auto s = merged.Next(); s != nullptr; s = merged.Next())
+    splits.push_back(s);
+
+  return splits;
+}
+
+MergedSplits::MergedSplits(const std::vector<const SplitPostings*>& postings,
+    Datetime from, Datetime to)
+    : size_(0) {
+  for (auto p : postings) {
+    for (auto& run : p->runs_) {
+      auto begin = std::lower_bound(run.begin(), run.end(), from,
+          [](const std::shared_ptr<Split>& s, const Datetime& date) {
+            return DateOf(s) < date;
+          });
+      auto end = std::upper_bound(begin, run.end(), to,
+          [](const Datetime& date, const std::shared_ptr<Split>& s) {
+            return date < DateOf(s);
+          });
+      if (begin == end) continue;
+
+      cursors_.push_back({&run, (size_t)(begin - run.begin()),
+          (size_t)(end - run.begin()), DateOf(*begin)});
+      size_ += end - begin;
+      Push(cursors_.size() - 1);
+    }
+  }
+}
+
+std::shared_ptr<Split> MergedSplits::Next() {
+  if (heap_.size() == 0) return nullptr;
+
+  std::pop_heap(heap_.begin(), heap_.end(),
+      [this](size_t a, size_t b) { return Later(a, b); });
+  size_t list = heap_.back();
+  heap_.pop_back();
+
+  auto& c = cursors_[list];
+  auto split = (*c.splits)[c.pos++];
+  if (c.pos < c.end) {
+    c.date = DateOf((*c.splits)[c.pos]);
+    Push(list);
+  }
+
+  return split;
+}
+
+void MergedSplits::Push(size_t list) {
+  heap_.push_back(list);
+  std::push_heap(heap_.begin(), heap_.end(),
+      [this](size_t a, size_t b) { return Later(a, b); });
+}
+
+bool MergedSplits::Later(size_t a, size_t b) const {
+  if (cursors_[a].date == cursors_[b].date) return a > b;
+  return cursors_[b].date < cursors_[a].date;
+}
@@ -0,0 +1,99 @@
+/// \file SplitPostings.hpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#ifndef SRC_SPLITPOSTINGS_HPP_
+#define SRC_SPLITPOSTINGS_HPP_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Amount.hpp"
+#include "Datetime.hpp"
+#include "Split.hpp"
+#include "Transaction.hpp"
+
+// A list of splits sorted by the date of their transactions, splits with the
+// same date are in the order they were added. The splits are kept in a few
+// runs that are each sorted by date and hold the splits added after those of
+// the runs before them. A new split starts a run of its own and the last runs
+// are merged while they are not larger than the new run, like the carries of a
+// binary counter, so there are O(log n) runs and adding a split costs
+// amortized O(log n) in whichever order the dates come. Reading never changes
+// the list, so several threads can read it at the same time.
+
+class SplitPostings {
+ public:
+  SplitPostings() : size_(0) {}
+
+  void Add(std::shared_ptr<Split> split);
+
+  // remove the split, the date of its transaction must be the same as when it
+  // was added, so it has to be removed before the date changes and added again
+  // afterwards
+  void Remove(const std::shared_ptr<Split>& split);
+
+  size_t Size() const { return size_; }
+
+  // all the splits sorted by date
+  std::vector<std::shared_ptr<Split>> Splits() const;
+
+ private:
+  friend class MergedSplits;
+
+  // the runs from the oldest to the newest
+  std::vector<std::vector<std::shared_ptr<Split>>> runs_;
+
+  size_t size_;
+};
+
+// Merges the date ranges of several posting lists into one sequence of splits
+// sorted by date, splits with the same date come in the order of the lists.
+// The posting lists must not change while the splits are merged.
+
+class MergedSplits {
+ public:
+  MergedSplits(const std::vector<const SplitPostings*>& postings,
+      Datetime from, Datetime to);
+
+  // the total number of splits that will be returned
+  size_t Size() const { return size_; }
+
+  // return the next split or nullptr if there are no more
+  std::shared_ptr<Split> Next();
+
+ private:
+  struct Cursor {
+    const std::vector<std::shared_ptr<Split>>* splits;
+    size_t pos, end;
+    Datetime date;
+  };
+
+  void Push(size_t list);
+
+  // true if the next split of list a comes after the next split of list b
+  bool Later(size_t a, size_t b) const;
+
+  std::vector<Cursor> cursors_;
+
+  // heap of the indices into cursors_ of the lists that have splits left,
+  // ordered by the date of their next split
+  std::vector<size_t> heap_;
+
+  size_t size_;
+};
+
+// one line of an account statement or a coin history
+struct StatementLine {
+  std::shared_ptr<Split> split;
+
+  // the balance in the split's coin after this split
+  Amount balance;
+};
+
+#endif  // SRC_SPLITPOSTINGS_HPP_
@@ -0,0 +1,200 @@
+/// \file TextIndex.cpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#include "TextIndex.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+// merge the sorted id lists and remove duplicates
+std::vector<uint32_t> Union(std::vector<std::vector<uint32_t>>* lists) {
+  std::vector<uint32_t> res;
+  for (auto& l : *lists) res.insert(res.end(), l.begin(), l.end());
+  std::sort(res.begin(), res.end());
+  res.erase(std::unique(res.begin(), res.end()), res.end());
+  return res;
+}
+
+std::vector<uint32_t> Intersect(
+    const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+  std::vector<uint32_t> res;
+  std::set_intersection(
+      a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(res));
+  return res;
+}
+
+}  // namespace
+
+std::vector<std::string> TextIndex::Tokenize(const std::string& text) {
+  std::vector<std::string> words;
+  std::string word;
+  for (unsigned char c : text) {
+    if (std::isalnum(c)) {
+      word += std::tolower(c);
+    } else if (word.size() > 0) {
+      words.push_back(word);
+      word.clear();
+    }
+  }
+  if (word.size() > 0) words.push_back(word);
+
+  return words;
+}
+
+bool TextIndex::WordMatches(
+    const std::string& word, const std::string& query_word, Match match) {
+  switch (match) {
+  case Match::Word:
+    return word == query_word;
+  case Match::Prefix:
+    return word.compare(0, query_word.size(), query_word) == 0;
+  default:
+    return word.find(query_word) != std::string::npos;
+  }
+}
+
+void TextIndex::Add(uint32_t doc, const std::string& text) {
+  for (auto& w : Tokenize(text)) {
+    auto it = words_.find(w);
+    if (it == words_.end()) {
+      uint32_t id = word_names_.size();
+      it = words_.insert({w, id}).first;
+      word_names_.push_back(w);
+      word_docs_.emplace_back();
+
+      for (size_t i = 0; i + 3 <= w.size(); ++i)
+        trigram_words_[w.substr(i, 3)].Add(id);
+    }
+
+    word_docs_[it->second].Add(doc);
+  }
+}
+
+std::vector<uint32_t> TextIndex::Find(
+    const std::string& query, Match match) const {
+  auto words = Tokenize(query);
+  if (words.size() == 0) return {};
+
+  auto res = FindWord(words[0], match);
+  for (size_t i = 1; (i < words.size()) && (res.size() > 0); ++i)
+    res = Intersect(res, FindWord(words[i], match));
+
+  return res;
+}
+
+size_t TextIndex::PostingBytes() const {
+  size_t bytes = 0;
+  for (auto& p : word_docs_) bytes += p.Bytes();
+  for (auto& t : trigram_words_) bytes += t.second.Bytes();
+  return bytes;
+}
+
+void TextIndex::Postings::Add(uint32_t id) {
+  if ((count_ > 0) && (id <= last_)) {
+    if ((id < last_) &&
+        (std::find(unsorted_.begin(), unsorted_.end(), id) == unsorted_.end()))
+      unsorted_.push_back(id);
+    return;
+  }
+
+  // the first id is stored as the difference to 0
+  uint32_t delta = id - last_;
+  while (delta >= 0x80) {
+    bytes_.push_back((delta & 0x7F) | 0x80);
+    delta >>= 7;
+  }
+  bytes_.push_back(delta);
+
+  last_ = id;
+  ++count_;
+}
+
+std::vector<uint32_t> TextIndex::Postings::Decode() const {
+  std::vector<uint32_t> ids;
+  ids.reserve(Count());
+
+  uint32_t id = 0;
+  uint32_t delta = 0;
+  int shift = 0;
+  for (uint8_t b : bytes_) {
+    delta |= uint32_t(b & 0x7F) << shift;
+    if (b & 0x80) {
+      shift += 7;
+    } else {
+      id += delta;
+      ids.push_back(id);
+      delta = 0;
+      shift = 0;
+    }
+  }
+
+  if (unsorted_.size() > 0) {
+    ids.insert(ids.end(), unsorted_.begin(), unsorted_.end());
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  }
+
+  return ids;
+}
+
+std::vector<uint32_t> TextIndex::FindWord(
+    const std::string& word, Match match) const {
+  std::vector<std::vector<uint32_t>> lists;
+
+  if (match == Match::Word) {
+    auto it = words_.find(word);
+    if (it != words_.end()) return word_docs_[it->second].Decode();
+  } else if (match == Match::Prefix) {
+    for (auto it = words_.lower_bound(word);
+         (it != words_.end()) && (it->first.compare(0, word.size(), word) == 0);
+         ++it) {
+      lists.push_back(word_docs_[it->second].Decode());
+    }
+  } else {
+    for (uint32_t w : WordsContaining(word))
+      lists.push_back(word_docs_[w].Decode());
+  }
+
+  return Union(&lists);
+}
+
+std::vector<uint32_t> TextIndex::WordsContaining(const std::string& sub) const {
+  std::vector<uint32_t> candidates;
+
+  if (sub.size() < 3) {
+    // too short for trigrams, check all words
+    candidates.resize(word_names_.size());
+    for (uint32_t w = 0; w < candidates.size(); ++w) candidates[w] = w;
+  } else {
+    // intersect the word lists of all trigrams, starting with the shortest
+    std::vector<const Postings*> lists;
+    for (size_t i = 0; i + 3 <= sub.size(); ++i) {
+      auto it = trigram_words_.find(sub.substr(i, 3));
+      if (it == trigram_words_.end()) return {};
+      lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(), [](const Postings* a,
+                                              const Postings* b) {
+      return a->Count() < b->Count();
+    });
+
+    candidates = lists[0]->Decode();
+    for (size_t i = 1; (i < lists.size()) && (candidates.size() > 0); ++i)
+      candidates = Intersect(candidates, lists[i]->Decode());
+  }
+
+  // the trigrams may appear in the word without forming the substring
+  std::vector<uint32_t> res;
+  for (uint32_t w : candidates) {
+    if (word_names_[w].find(sub) != std::string::npos) res.push_back(w);
+  }
+
+  return res;
+}
@@ -0,0 +1,99 @@
+/// \file TextIndex.hpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#ifndef SRC_TEXTINDEX_HPP_
+#define SRC_TEXTINDEX_HPP_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// An inverted index from the words in texts to the ids of the documents that
+// contain them. Words are the runs of letters and digits, compared case
+// insensitively. The words are kept sorted for prefix search, and every word
+// is also indexed by all its trigrams (3 character substrings), so that the
+// words containing a substring are found by intersecting the word lists of
+// the substring's trigrams instead of looking at every word.
+//
+// All postings are stored as varint encoded differences between consecutive
+// ids, which are usually small because documents are added in increasing
+// order of their ids and words get increasing ids as they are first seen.
+
+class TextIndex {
+ public:
+  enum class Match {
+    // the document contains the word
+    Word,
+    // the document contains a word starting with the given string
+    Prefix,
+    // the document contains a word containing the given string
+    Substring
+  };
+
+  // split the text into lowercase words
+  static std::vector<std::string> Tokenize(const std::string& text);
+
+  // return true if the word (as returned by Tokenize) matches the query word
+  static bool WordMatches(
+      const std::string& word, const std::string& query_word, Match match);
+
+  // add the words of the text to the document with the given id
+  void Add(uint32_t doc, const std::string& text);
+
+  // return the sorted ids of the documents that match every word in the
+  // query, an empty query matches nothing
+  std::vector<uint32_t> Find(const std::string& query, Match match) const;
+
+  // return the number of distinct words and the total size of the compressed
+  // postings in bytes
+  size_t NumWords() const { return words_.size(); }
+  size_t PostingBytes() const;
+
+ private:
+  // sorted list of document or word ids
+  class Postings {
+   public:
+    Postings() : count_(0), last_(0) {}
+
+    void Add(uint32_t id);
+
+    // decode all the ids, in sorted order
+    std::vector<uint32_t> Decode() const;
+
+    size_t Count() const { return count_ + unsorted_.size(); }
+    size_t Bytes() const { return bytes_.size() + 4 * unsorted_.size(); }
+
+   private:
+    std::vector<uint8_t> bytes_;
+    uint32_t count_, last_;
+
+    // ids that are smaller than the last encoded one, this only happens if
+    // text is added to an old document, which is rare
+    std::vector<uint32_t> unsorted_;
+  };
+
+  // the documents containing one word of the query
+  std::vector<uint32_t> FindWord(const std::string& word, Match match) const;
+
+  // the ids of the words containing the substring
+  std::vector<uint32_t> WordsContaining(const std::string& sub) const;
+
+  // the id of every word, sorted by word for prefix search
+  std::map<std::string, uint32_t> words_;
+
+  // the word with each id and the documents containing it
+  std::vector<std::string> word_names_;
+  std::vector<Postings> word_docs_;
+
+  // the ids of the words containing each trigram
+  std::unordered_map<std::string, Postings> trigram_words_;
+};
+
+#endif  // SRC_TEXTINDEX_HPP_
@@ -37,25 +37,23 @@ std::shared_ptr<Transaction> Transaction::Create(File* file, Datetime date,
   auto transaction = file->AddTransaction(
       Transaction(transaction_id, date, description, import_id));
 
-  // now create the splits and add them to the transaction
-  for (auto& s : protoSplits) {
-    auto split = Split::Create(file, transaction, s);
-    transaction->AddSplit(split);
-  }
+  // now create the splits, which adds them to the transaction
+  for (auto& s : protoSplits) Split::Create(file, transaction, s);
 
   return transaction;
 }
 
-bool Transaction::Matched() const {
-  bool positive = false;
-  bool negative = false;
+void Transaction::AddSplit(std::shared_ptr<Split> split) {
+  if (split->GetAmount() > 0) has_positive_ = true;
+  if (split->GetAmount() < 0) has_negative_ = true;
 
-  for (auto s : splits_) {
-    if (s->GetAmount() > 0) positive = true;
-    if (s->GetAmount() < 0) negative = true;
-  }
+  if (splits_.size() == 0)
+    coin_ = split->GetCoin();
+  else if ((coin_ != nullptr) && (split->GetCoin()->Id() != coin_->Id()))
+    coin_ = nullptr;
 
-  return (positive && negative);
+  total_ += split->GetAmount();
+  splits_.push_back(split);
 }
 
 bool Transaction::Balanced() const {
@@ -63,15 +61,8 @@ bool Transaction::Balanced() const {
 
   if (splits_.size() < 2) return false;
 
-  auto coin = GetCoin();
-
-  if (coin != nullptr) {
-    // make sure all the amounts add up to 0
-    Amount sum = 0;
-    for (auto& s : splits_) sum += s->GetAmount();
-
-    if (sum != 0) return false;
-  }
+  // if all splits are the same coin, make sure all the amounts add up to 0
+  if ((coin_ != nullptr) && (total_ != 0)) return false;
 
   return true;
 }
@@ -83,17 +74,6 @@ bool Transaction::HasSplitWithImportId(const std::string& import_id) const {
   return false;
 }
 
-std::shared_ptr<const Coin> Transaction::GetCoin() const {
-  auto coin = splits_[0]->GetCoin();
-  for (size_t i = 1; i < splits_.size(); ++i) {
-    if (splits_[i]->GetCoin()->Id() != coin->Id()) {
-      return nullptr;
-    }
-  }
-
-  return coin;
-}
-
 void Transaction::Print(const bool print_import_id) const {
   auto desc = Description();
   if (!Matched())
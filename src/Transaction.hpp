@@ -32,13 +32,13 @@ class Transaction {
   const std::string& Import_id() const { return import_id_; }
   const std::vector<std::shared_ptr<Split>>& Splits() const { return splits_; }
 
-  void SetDate(Datetime date) { date_ = date; }
-
-  void AddSplit(std::shared_ptr<Split> split) { splits_.push_back(split); }
+  // dense index of this transaction in the file, in the order the
+  // transactions were added
+  size_t Index() const { return index_; }
 
   // return true if the transaction has matched splits, i.e. there is a positive
   // and a negative split
-  bool Matched() const;
+  bool Matched() const { return has_positive_ && has_negative_; }
 
   // return true if the transaction is balanced. The transaction needs to be
   // matched in order to be balanced, and additionally, if all the splits are
@@ -48,9 +48,13 @@ class Transaction {
   // return true if the transaction has a split with this import id
   bool HasSplitWithImportId(const std::string& import_id) const;
 
-  // if all splits have the same coin, return that coin, otherwise return
-  // nullptr
-  std::shared_ptr<const Coin> GetCoin() const;
+  // if all splits have the same coin, return that coin, otherwise (or if there
+  // are no splits) return nullptr
+  std::shared_ptr<const Coin> GetCoin() const { return coin_; }
+
+  // the sum of the amounts of all splits, this is only meaningful if all
+  // splits have the same coin
+  Amount Total() const { return total_; }
 
   void Print(const bool print_import_id) const;
 
@@ -62,7 +66,20 @@ class Transaction {
       : id_(id),
         date_(date),
         description_(description),
-        import_id_(import_id) {}
+        import_id_(import_id),
+        has_positive_(false),
+        has_negative_(false),
+        coin_(nullptr),
+        total_(0),
+        index_(0) {}
+
+  // splits are only added through File::AddSplit, which keeps the status of
+  // the transaction in the file up to date
+  void AddSplit(std::shared_ptr<Split> split);
+
+  // the date is only changed through File::SetTransactionDate, which keeps the
+  // date index of the file up to date
+  void SetDate(Datetime date) { date_ = date; }
 
   // unique global identifier of this transaction
   const uuid_t id_;
@@ -79,6 +96,21 @@ class Transaction {
 
   // the splits that make up this transaction
   std::vector<std::shared_ptr<Split>> splits_;
+
+  // the status of the transaction is updated every time a split is added, so
+  // that Matched(), Balanced(), and GetCoin() don't need to loop over splits
+
+  // true if there is a split with a positive/negative amount
+  bool has_positive_, has_negative_;
+
+  // the coin of all splits, nullptr if there are different coins
+  std::shared_ptr<const Coin> coin_;
+
+  // the sum of all split amounts
+  Amount total_;
+
+  // dense index assigned by the file
+  size_t index_;
 };
 
 #endif  // SRC_TRANSACTION_HPP_
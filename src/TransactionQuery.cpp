@@ -0,0 +1,130 @@
+/// \file TransactionQuery.cpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#include "TransactionQuery.hpp"
+
+namespace {
+
+bool StartsWith(const std::string& str, const std::string& prefix) {
+  return str.compare(0, prefix.size(), prefix) == 0;
+}
+
+}  // namespace
+
+bool TransactionQuery::Matches(std::shared_ptr<const Transaction> txn) const {
+  // cheap conditions first
+  if (from_ && (txn->Date() < *from_)) return false;
+  if (to_ && (*to_ < txn->Date())) return false;
+  if (balanced_ && (txn->Balanced() != *balanced_)) return false;
+  if (matched_ && (txn->Matched() != *matched_)) return false;
+
+  if (HasSplitConditions()) {
+    bool found = false;
+    for (auto& s : txn->Splits()) {
+      if (MatchesSplit(*s)) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) return false;
+  }
+
+  if (import_id_prefix_ != "") {
+    bool found = StartsWith(txn->Import_id(), import_id_prefix_);
+    for (size_t i = 0; !found && (i < txn->Splits().size()); ++i)
+      found = StartsWith(txn->Splits()[i]->Import_id(), import_id_prefix_);
+    if (!found) return false;
+  }
+
+  if ((text_.size() > 0) && !MatchesText(txn)) return false;
+
+  for (auto& pred : predicates_) {
+    if (!pred(txn)) return false;
+  }
+
+  return true;
+}
+
+bool TransactionQuery::MatchesSplit(const Split& split) const {
+  if ((coin_ != nullptr) && (split.GetCoin()->Id() != coin_->Id()))
+    return false;
+  if (min_amount_ && (split.GetAmount() < *min_amount_)) return false;
+  if (max_amount_ && (split.GetAmount() > *max_amount_)) return false;
+  if ((account_ != nullptr) && !split.GetAccount()->IsContainedIn(account_))
+    return false;
+
+  return true;
+}
+
+std::string TransactionQuery::GetText() const {
+  std::string text;
+  for (auto& w : text_) text += (text.size() > 0 ? " " : "") + w;
+  return text;
+}
+
+bool TransactionQuery::MatchesText(
+    std::shared_ptr<const Transaction> txn) const {
+  auto words = TextIndex::Tokenize(txn->Description());
+  for (auto& s : txn->Splits()) {
+    auto memo_words = TextIndex::Tokenize(s->Memo());
+    words.insert(words.end(), memo_words.begin(), memo_words.end());
+  }
+
+  for (auto& q : text_) {
+    bool found = false;
+    for (size_t i = 0; !found && (i < words.size()); ++i)
+      found = TextIndex::WordMatches(words[i], q, text_match_);
+    if (!found) return false;
+  }
+
+  return true;
+}
+
+TransactionPredicate TransactionQuery::AsPredicate() const {
+  auto query = *this;
+  return [query](std::shared_ptr<const Transaction> txn) {
+    return query.Matches(txn);
+  };
+}
+
+TransactionPredicate TransactionQuery::AllOf(
+    std::vector<TransactionPredicate> preds) {
+  return [preds](std::shared_ptr<const Transaction> txn) {
+    for (auto& p : preds) {
+      if (!p(txn)) return false;
+    }
+    return true;
+  };
+}
+
+TransactionPredicate TransactionQuery::AnyOf(
+    std::vector<TransactionPredicate> preds) {
+  return [preds](std::shared_ptr<const Transaction> txn) {
+    for (auto& p : preds) {
+      if (p(txn)) return true;
+    }
+    return false;
+  };
+}
+
+TransactionPredicate TransactionQuery::Not(TransactionPredicate pred) {
+  return [pred](std::shared_ptr<const Transaction> txn) { return !pred(txn); };
+}
+
+std::shared_ptr<Transaction> TransactionCursor::Next() {
+  while (true) {
+    auto txn = source_();
+    if ((txn == nullptr) || query_.Matches(txn)) return txn;
+  }
+}
+
+std::vector<std::shared_ptr<Transaction>> TransactionCursor::All() {
+  std::vector<std::shared_ptr<Transaction>> res;
+  for (auto txn = Next(); txn != nullptr; txn = Next()) res.push_back(txn);
+  return res;
+}
@@ -0,0 +1,207 @@
+/// \file TransactionQuery.hpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#ifndef SRC_TRANSACTIONQUERY_HPP_
+#define SRC_TRANSACTIONQUERY_HPP_
+
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "Account.hpp"
+#include "Amount.hpp"
+#include "Coin.hpp"
+#include "Datetime.hpp"
+#include "Split.hpp"
+#include "TextIndex.hpp"
+#include "Transaction.hpp"
+
+typedef std::function<bool(std::shared_ptr<const Transaction>)>
+    TransactionPredicate;
+
+// A set of conditions on transactions that is run with File::Query. All the
+// conditions must hold. The account, coin, and amount conditions apply to
+// splits, and a transaction matches them if one of its splits matches all of
+// them. Arbitrary other conditions can be added with Where() and combined with
+// AllOf(), AnyOf(), and Not().
+
+class TransactionQuery {
+ public:
+  TransactionQuery() : text_match_(TextIndex::Match::Substring) {}
+
+  // a split is in the account or one of its sub accounts
+  TransactionQuery& InAccount(std::shared_ptr<const Account> account) {
+    account_ = account;
+    return *this;
+  }
+
+  // a split is in the coin
+  TransactionQuery& WithCoin(std::shared_ptr<const Coin> coin) {
+    coin_ = coin;
+    return *this;
+  }
+
+  // a split has min <= amount <= max
+  TransactionQuery& AmountBetween(Amount min, Amount max) {
+    min_amount_ = min;
+    max_amount_ = max;
+    return *this;
+  }
+
+  // the transaction is dated at or after from and at or before to
+  TransactionQuery& From(Datetime from) {
+    from_ = from;
+    return *this;
+  }
+  TransactionQuery& To(Datetime to) {
+    to_ = to;
+    return *this;
+  }
+  TransactionQuery& Between(Datetime from, Datetime to) {
+    return From(from).To(to);
+  }
+
+  // the import id of the transaction or one of its splits starts with prefix
+  TransactionQuery& ImportIdPrefix(const std::string& prefix) {
+    import_id_prefix_ = prefix;
+    return *this;
+  }
+
+  // every word of text matches a word in the description or a memo of the
+  // transaction (case insensitive)
+  TransactionQuery& Text(const std::string& text,
+      TextIndex::Match match = TextIndex::Match::Substring) {
+    text_ = TextIndex::Tokenize(text);
+    text_match_ = match;
+    return *this;
+  }
+
+  TransactionQuery& IsBalanced(bool balanced) {
+    balanced_ = balanced;
+    return *this;
+  }
+  TransactionQuery& IsMatched(bool matched) {
+    matched_ = matched;
+    return *this;
+  }
+
+  // any other condition
+  TransactionQuery& Where(TransactionPredicate predicate) {
+    predicates_.push_back(predicate);
+    return *this;
+  }
+
+  std::shared_ptr<const Account> GetAccount() const { return account_; }
+  std::shared_ptr<const Coin> GetCoin() const { return coin_; }
+  const boost::optional<Datetime>& GetFrom() const { return from_; }
+  const boost::optional<Datetime>& GetTo() const { return to_; }
+  // the words of the text condition, joined by spaces
+  std::string GetText() const;
+  TextIndex::Match GetTextMatch() const { return text_match_; }
+  const boost::optional<bool>& GetBalanced() const { return balanced_; }
+  const boost::optional<bool>& GetMatched() const { return matched_; }
+
+  bool Matches(std::shared_ptr<const Transaction> txn) const;
+
+  // true if the split satisfies the account, coin, and amount conditions
+  bool MatchesSplit(const Split& split) const;
+
+  // this query as a predicate, so that it can be combined with others
+  TransactionPredicate AsPredicate() const;
+
+  static TransactionPredicate AllOf(std::vector<TransactionPredicate> preds);
+  static TransactionPredicate AnyOf(std::vector<TransactionPredicate> preds);
+  static TransactionPredicate Not(TransactionPredicate pred);
+
+ private:
+  bool MatchesText(std::shared_ptr<const Transaction> txn) const;
+
+  bool HasSplitConditions() const {
+    return (account_ != nullptr) || (coin_ != nullptr) || min_amount_ ||
+           max_amount_;
+  }
+
+  std::shared_ptr<const Account> account_;
+  std::shared_ptr<const Coin> coin_;
+  boost::optional<Amount> min_amount_, max_amount_;
+  boost::optional<Datetime> from_, to_;
+  std::string import_id_prefix_;
+  std::vector<std::string> text_;
+  TextIndex::Match text_match_;
+  boost::optional<bool> balanced_, matched_;
+  std::vector<TransactionPredicate> predicates_;
+};
+
+// The transactions matching a query in date order, they are only found as the
+// cursor advances. The cursor reads the indexes of the file it came from, so
+// the file must outlive the cursor and must not be modified while the cursor
+// is in use.
+
+class TransactionCursor {
+ public:
+  // returns the next candidate transaction or nullptr when there are no more
+  typedef std::function<std::shared_ptr<Transaction>()> Source;
+
+  TransactionCursor(
+      Source source, const TransactionQuery& query, std::string access_path)
+      : source_(source), query_(query), access_path_(access_path) {}
+
+  // a description of the index that was used to find candidate transactions
+  const std::string& AccessPath() const { return access_path_; }
+
+  // return the next matching transaction or nullptr if there are no more
+  std::shared_ptr<Transaction> Next();
+
+  // return all the remaining matching transactions
+  std::vector<std::shared_ptr<Transaction>> All();
+
+  class iterator
+      : public std::iterator<std::input_iterator_tag,
+            std::shared_ptr<Transaction>> {
+   public:
+    iterator() : cursor_(nullptr) {}
+    explicit iterator(TransactionCursor* cursor)
+        : cursor_(cursor), current_(cursor->Next()) {
+      if (current_ == nullptr) cursor_ = nullptr;
+    }
+
+    const std::shared_ptr<Transaction>& operator*() const { return current_; }
+    const std::shared_ptr<Transaction>* operator->() const {
+      return &current_;
+    }
+
+    iterator& operator++() {
+      current_ = cursor_->Next();
+      if (current_ == nullptr) cursor_ = nullptr;
+      return *this;
+    }
+
+    bool operator==(const iterator& other) const {
+      return cursor_ == other.cursor_;
+    }
+    bool operator!=(const iterator& other) const { return !(*this == other); }
+
+   private:
+    TransactionCursor* cursor_;
+    std::shared_ptr<Transaction> current_;
+  };
+
+  iterator begin() { return iterator(this); }
+  iterator end() { return iterator(); }
+
+ private:
+  Source source_;
+  TransactionQuery query_;
+  std::string access_path_;
+};
+
+#endif  // SRC_TRANSACTIONQUERY_HPP_
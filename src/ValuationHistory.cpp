@@ -0,0 +1,47 @@
+/// \file ValuationHistory.cpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#include "ValuationHistory.hpp"
+
+ValuationHistory::ValuationHistory(const BalanceHistory& holdings,
+    const std::vector<std::vector<double>>& prices)
+    : first_day_(holdings.FirstDay()),
+      last_day_(holdings.LastDay()),
+      accounts_(holdings.Accounts()),
+      values_(accounts_.size(), std::vector<double>(NumDays(), 0.0)) {
+  auto& coins = holdings.Coins();
+  if (prices.size() != coins.size())
+    throw std::invalid_argument("ValuationHistory: need prices for " +
+                                std::to_string(coins.size()) + " coins");
+
+  for (auto& p : prices) {
+    if (p.size() != NumDays())
+      throw std::invalid_argument(
+          "ValuationHistory: prices must cover all days of the holdings");
+  }
+
+  for (size_t a = 0; a < accounts_.size(); ++a) {
+    account_pos_.insert({{accounts_[a]->Id(), a}});
+    double* values = values_[a].data();
+
+    for (size_t c = 0; c < coins.size(); ++c) {
+      auto& days = holdings.ChangeDays(accounts_[a], coins[c]);
+      auto& balances = holdings.ChangeBalances(accounts_[a], coins[c]);
+      const double* price = prices[c].data();
+
+      for (size_t i = 0; i < days.size(); ++i) {
+        double holding = balances[i].ToDouble();
+        size_t begin = days[i] - first_day_;
+        size_t end =
+            (i + 1 < days.size() ? days[i + 1] : last_day_ + 1) - first_day_;
+
+        for (size_t d = begin; d < end; ++d) values[d] += holding * price[d];
+      }
+    }
+  }
+}
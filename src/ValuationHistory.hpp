@@ -0,0 +1,60 @@
+/// \file ValuationHistory.hpp
+/// \author jlippuner
+/// \since Oct 18, 2026
+///
+/// \brief
+///
+///
+
+#ifndef SRC_VALUATIONHISTORY_HPP_
+#define SRC_VALUATIONHISTORY_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "Account.hpp"
+#include "BalanceHistory.hpp"
+#include "UUID.hpp"
+
+// The daily USD value of a set of accounts, computed from the daily holdings in
+// a BalanceHistory and daily USD prices of all the coins in it.
+//
+// The holdings only change on a few days, so for every (account, coin) the
+// value is accumulated as holding * price over the ranges of days between the
+// changes. These are plain loops over contiguous double arrays that the
+// compiler can vectorize. The values are doubles, which is precise enough for
+// charts but not for accounting.
+
+class ValuationHistory {
+ public:
+  // prices[c][d] is the USD price of holdings.Coins()[c] on day
+  // holdings.FirstDay() + d
+  ValuationHistory(const BalanceHistory& holdings,
+      const std::vector<std::vector<double>>& prices);
+
+  int64_t FirstDay() const { return first_day_; }
+  int64_t LastDay() const { return last_day_; }
+  size_t NumDays() const { return last_day_ - first_day_ + 1; }
+
+  const std::vector<std::shared_ptr<const Account>>& Accounts() const {
+    return accounts_;
+  }
+
+  // the USD value of the account at the end of every day from FirstDay() to
+  // LastDay()
+  const std::vector<double>& Values(
+      std::shared_ptr<const Account> account) const {
+    return values_[account_pos_.at(account->Id())];
+  }
+
+ private:
+  int64_t first_day_, last_day_;
+
+  std::vector<std::shared_ptr<const Account>> accounts_;
+
+  UUIDMap<size_t> account_pos_;
+
+  std::vector<std::vector<double>> values_;
+};
+
+#endif  // SRC_VALUATIONHISTORY_HPP_
@@ -82,7 +82,7 @@ void Binance::Import(const std::string& import_file, File* file,
 
     // if a transaction with this import id already exists, check if it has a
     // split with this split id
-    if ((txn != nullptr) && (txn->HasSplitWithImportId(split_id))) {
+    if ((txn != nullptr) && file->HasSplitImportId(split_id, txn)) {
       // it is possible that we legitimately get the same split, so just warn
       // here
       printf("WARNING: Possible duplicate: %s\n", split_id.c_str());
@@ -139,8 +139,7 @@ void Binance::Import(const std::string& import_file, File* file,
     } else {
       // the transaction already exists, just add the new splits
       for (auto& proto_s : splits) {
-        auto split = Split::Create(file, txn, proto_s);
-        txn->AddSplit(split);
+        Split::Create(file, txn, proto_s);
       }
     }
     ++num_imported;
@@ -80,7 +80,7 @@ void CoreWallet::Import(const std::string& import_file, File* file,
     // if a transaction with this import id already exists, check if it has a
     // split with this split id, in which case we don't need to duplicate this
     // split
-    if ((txn != nullptr) && (txn->HasSplitWithImportId(split_id))) {
+    if ((txn != nullptr) && file->HasSplitImportId(split_id, txn)) {
       ++num_duplicate;
       continue;
     }
@@ -135,10 +135,9 @@ void CoreWallet::Import(const std::string& import_file, File* file,
     } else {
       // the transaction already exists, just add the new splits
       for (auto& proto_s : splits) {
-        auto split = Split::Create(file, txn, proto_s);
-        txn->AddSplit(split);
+        Split::Create(file, txn, proto_s);
       }
-      txn->SetDate(time);
+      file->SetTransactionDate(txn, time);
     }
     ++num_imported;
   }
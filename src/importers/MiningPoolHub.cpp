@@ -191,7 +191,7 @@ void MiningPoolHub::Import(const std::string& import_file, File* file,
     // split
     std::vector<ProtoSplit> new_splits;
     for (auto& sp : splits) {
-      if ((txn != nullptr) && (txn->HasSplitWithImportId(sp.import_id_))) {
+      if ((txn != nullptr) && file->HasSplitImportId(sp.import_id_, txn)) {
         ++num_duplicate;
       } else {
         new_splits.push_back(sp);
@@ -206,8 +206,7 @@ void MiningPoolHub::Import(const std::string& import_file, File* file,
     } else {
       // the transaction already exists, just add the new splits
       for (auto& proto_s : new_splits) {
-        auto split = Split::Create(file, txn, proto_s);
-        txn->AddSplit(split);
+        Split::Create(file, txn, proto_s);
       }
     }
   }
@@ -1,6 +1,7 @@
 #include "DailyData.hpp"
 
 #include <htmlcxx/html/ParserDom.h>
+#include <algorithm>
 #include <exception>
 #include <thread>
 
@@ -117,6 +118,37 @@ Amount DailyData::operator()(const Datetime& date) {
   }
 }
 
+bool DailyData::Find(const Datetime& date, Amount* price) const {
+  int64_t idx = date.DailyDataDay() - start_day_;
+  if ((idx < 0) || (idx >= (int64_t)prices_.size())) return false;
+
+  *price = prices_[idx];
+  return true;
+}
+
+void DailyData::Prefetch(int64_t from, int64_t to) {
+  if (to < from) throw std::invalid_argument("to must be larger than from");
+
+  // fetching the last day first means that the first day only requires one
+  // more fetch of all the data before the existing data
+  if ((start_day_ == 0) || (to >= start_day_ + (int64_t)prices_.size()))
+    (*this)(Datetime::FromUNIXTimestamp(to * 24 * 3600));
+  if (from < start_day_) (*this)(Datetime::FromUNIXTimestamp(from * 24 * 3600));
+}
+
+std::vector<double> DailyData::PricesAsDouble(int64_t from, int64_t to) const {
+  std::vector<double> res(to - from + 1, 0.0);
+  if (prices_.size() == 0) return res;
+
+  // a coin that was listed after from has no market price before its listing
+  // day, so holding it is worth nothing on those days
+  int64_t last = start_day_ + prices_.size() - 1;
+  for (int64_t d = std::max(from, start_day_); d <= to; ++d)
+    res[d - from] = prices_[std::min(d, last) - start_day_].ToDouble();
+
+  return res;
+}
+
 std::pair<std::vector<int64_t>, std::vector<Amount>> DailyData::GetData(
     int64_t from, int64_t to) const {
   if (coin_->NumId() <= 0)
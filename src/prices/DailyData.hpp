@@ -21,6 +21,22 @@ class DailyData {
 
   Amount operator()(const Datetime& date);
 
+  // get the price on the day of date if it is available without fetching any
+  // data, return false otherwise, this never modifies the data and so it can
+  // be called from several threads at the same time
+  bool Find(const Datetime& date, Amount* price) const;
+
+  // make sure that the prices of all days from day from to day to are
+  // available, this fetches at most two ranges of missing data
+  void Prefetch(int64_t from, int64_t to);
+
+  // the prices of all days from day from to day to as doubles, Prefetch(from,
+  // to) should have been called, days before the first available price (e.g.
+  // before the coin was listed) are 0 because the coin had no market price and
+  // days after the last available price get the last available price, all days
+  // are 0 if there are no prices at all
+  std::vector<double> PricesAsDouble(int64_t from, int64_t to) const;
+
  private:
   std::pair<std::vector<int64_t>, std::vector<Amount>> GetData(
       int64_t from, int64_t to) const;
@@ -1,63 +1,312 @@
 #include "Inventory.hpp"
 #include "Datetime.hpp"
 
+#include <algorithm>
+
+Inventory::Inventory(const State& state)
+    : method_(state.method),
+      num_used_(0),
+      next_(0),
+      pool_amount_(state.pool_amount),
+      pool_cost_(state.pool_cost),
+      unsold_amount_(0),
+      unsold_cost_(0) {
+  if ((method_ == LotMethod::HIFO) &&
+      (state.unit_costs.size() != state.lots.size()))
+    throw std::invalid_argument("Need the cost per unit of every HIFO lot");
+
+  for (auto& l : state.lots) {
+    unsold_amount_ += l.amount;
+    unsold_cost_ += l.cost_in_usd;
+  }
+
+  if ((method_ == LotMethod::FIFO) || (method_ == LotMethod::LIFO) ||
+      (method_ == LotMethod::AverageCost)) {
+    basis_.assign(state.lots.begin(), state.lots.end());
+    return;
+  }
+
+  // only the unconsumed lots are restored, so none of them is used and the
+  // lots keep their relative order
+  lots_ = state.lots;
+  used_.assign(lots_.size(), false);
+  for (size_t i = 0; i < lots_.size(); ++i) {
+    if (method_ == LotMethod::HIFO)
+      heap_.push_back({state.unit_costs[i], i});
+    else
+      lot_index_[lots_[i].lot_id].push_back(i);
+  }
+  std::make_heap(heap_.begin(), heap_.end(), LowerPriority);
+}
+
 void Inventory::Acquire(InventoryItem item) {
-  if ((basis_.size() > 0) && (item.date < basis_.back().date))
+  bool use_basis = (method_ == LotMethod::FIFO) ||
+                   (method_ == LotMethod::LIFO) ||
+                   (method_ == LotMethod::AverageCost);
+
+  if (use_basis && (basis_.size() > 0) && (item.date < basis_.back().date))
+    throw std::runtime_error("Going backwards in time in Inventory::Acquire");
+  if (!use_basis && (lots_.size() > 0) && (item.date < lots_.back().date))
     throw std::runtime_error("Going backwards in time in Inventory::Acquire");
 
-  basis_.push_back(item);
+  unsold_amount_ += item.amount;
+  unsold_cost_ += item.cost_in_usd;
+
+  if (use_basis) {
+    if (method_ == LotMethod::AverageCost) {
+      pool_amount_ += item.amount;
+      pool_cost_ += item.cost_in_usd;
+    }
+
+    basis_.push_back(item);
+    return;
+  }
+
+  if (method_ == LotMethod::HIFO) {
+    Amount unit_cost =
+        (item.amount == 0) ? Amount(0) : item.cost_in_usd / item.amount;
+    heap_.push_back({unit_cost, lots_.size()});
+    std::push_heap(heap_.begin(), heap_.end(), LowerPriority);
+  } else {
+    lot_index_[item.lot_id].push_back(lots_.size());
+  }
+
+  lots_.push_back(item);
+  used_.push_back(false);
+}
+
+bool Inventory::Consume(InventoryItem* lot, Amount* remaining,
+    std::vector<InventoryItem>* consumed) {
+  if (*remaining >= lot->amount) {
+    // completely consume the lot
+    consumed->push_back(*lot);
+    *remaining -= lot->amount;
+    return true;
+  } else {
+    // partially consume the lot
+    InventoryItem partial(*lot);
+
+    partial.amount = *remaining;
+    partial.cost_in_usd = (lot->cost_in_usd * *remaining) / lot->amount;
+
+    lot->amount -= partial.amount;
+    lot->cost_in_usd -= partial.cost_in_usd;
+
+    consumed->push_back(partial);
+    *remaining = 0;
+    return false;
+  }
 }
 
-std::vector<InventoryItem> Inventory::Dispose(Amount amount) {
+std::vector<InventoryItem> Inventory::Dispose(
+    Amount amount, const std::vector<std::string>& lot_ids) {
   std::vector<InventoryItem> consumed;
   Amount remaining = amount;
 
-  while (remaining > 0) {
-    if (basis_.size() == 0)
-      throw std::runtime_error("Amount remaining but no inventory");
+  if ((method_ == LotMethod::FIFO) || (method_ == LotMethod::LIFO)) {
+    bool LIFO = (method_ == LotMethod::LIFO);
 
-    auto& match = LIFO_ ? basis_.back() : basis_.front();
+    while (remaining > 0) {
+      if (basis_.size() == 0)
+        throw std::runtime_error("Amount remaining but no inventory");
 
-    if (remaining >= match.amount) {
-      // completely consume the match
-      consumed.push_back(match);
-      remaining -= match.amount;
+      auto& match = LIFO ? basis_.back() : basis_.front();
+      if (Consume(&match, &remaining, &consumed)) {
+        if (LIFO)
+          basis_.pop_back();
+        else
+          basis_.pop_front();
+      }
+    }
+  } else if (method_ == LotMethod::HIFO) {
+    while (remaining > 0) {
+      if (heap_.size() == 0)
+        throw std::runtime_error("Amount remaining but no inventory");
 
-      if (LIFO_)
-        basis_.pop_back();
-      else
-        basis_.pop_front();
-    } else {
-      // partially consume the latest acquisition
-      InventoryItem partial(match);
+      size_t idx = heap_.front().second;
+      if (Consume(&lots_[idx], &remaining, &consumed)) {
+        MarkUsed(idx);
+        std::pop_heap(heap_.begin(), heap_.end(), LowerPriority);
+        heap_.pop_back();
+      }
+    }
+  } else if (method_ == LotMethod::SpecificID) {
+    // first consume the named lots, oldest first, a used lot leaves the lot
+    // index so the next one is always at the front
+    for (auto& id : lot_ids) {
+      while (remaining > 0) {
+        auto it = lot_index_.find(id);
+        if (it == lot_index_.end()) break;
 
-      partial.amount = remaining;
-      partial.cost_in_usd = (match.cost_in_usd * remaining) / match.amount;
+        size_t idx = it->second.front();
+        if (Consume(&lots_[idx], &remaining, &consumed)) MarkUsed(idx);
+      }
+    }
 
-      match.amount -= partial.amount;
-      match.cost_in_usd -= partial.cost_in_usd;
+    // then the oldest lots
+    while (remaining > 0) {
+      while ((next_ < lots_.size()) && used_[next_]) ++next_;
+      if (next_ == lots_.size())
+        throw std::runtime_error("Amount remaining but no inventory");
 
-      consumed.push_back(partial);
-      remaining = 0;
+      if (Consume(&lots_[next_], &remaining, &consumed)) MarkUsed(next_);
     }
+  } else {
+    // the average cost per unit is the same for all lots, but the lots are
+    // consumed FIFO to get the acquisition dates for the holding periods
+    while (remaining > 0) {
+      if (basis_.size() == 0)
+        throw std::runtime_error("Amount remaining but no inventory");
+
+      auto& match = basis_.front();
+      bool whole = (remaining >= match.amount);
+      Amount take = whole ? match.amount : remaining;
+
+      // make sure the pool cost goes to 0 together with the pool amount
+      Amount cost(0);
+      if (take == pool_amount_)
+        cost = pool_cost_;
+      else if (pool_amount_ != 0)
+        cost = (pool_cost_ * take) / pool_amount_;
+
+      pool_amount_ -= take;
+      pool_cost_ -= cost;
+      remaining -= take;
+
+      consumed.push_back(InventoryItem(match.date, take, cost, match.lot_id));
+      if (whole)
+        basis_.pop_front();
+      else
+        match.amount -= take;
+    }
+  }
+
+  for (auto& c : consumed) {
+    unsold_amount_ -= c.amount;
+    unsold_cost_ -= c.cost_in_usd;
   }
 
+  if (2 * num_used_ > lots_.size()) Compact();
+
   return consumed;
 }
 
-UnsoldInventory Inventory::Unsold(size_t long_term_in_days) const {
+void Inventory::MarkUsed(size_t idx) {
+  used_[idx] = true;
+  ++num_used_;
+  if (method_ != LotMethod::SpecificID) return;
+
+  auto it = lot_index_.find(lots_[idx].lot_id);
+  auto& ids = it->second;
+  ids.erase(std::find(ids.begin(), ids.end(), idx));
+  if (ids.size() == 0) lot_index_.erase(it);
+}
+
+void Inventory::Compact() {
+  // the new index of every unused lot, which keeps the order of the lots, so
+  // the heap stays a heap and the lot index stays sorted
+  std::vector<size_t> new_idx(lots_.size());
+  size_t n = 0;
+  for (size_t i = 0; i < lots_.size(); ++i) {
+    if (used_[i]) continue;
+    new_idx[i] = n;
+    lots_[n] = lots_[i];
+    ++n;
+  }
+
+  lots_.erase(lots_.begin() + n, lots_.end());
+  used_.assign(n, false);
+  num_used_ = 0;
+  next_ = 0;
+
+  for (auto& h : heap_) h.second = new_idx[h.second];
+  for (auto& itm : lot_index_) {
+    for (auto& idx : itm.second) idx = new_idx[idx];
+  }
+}
+
+UnsoldInventory Inventory::Unsold(
+    size_t long_term_in_days, Datetime as_of) const {
   UnsoldInventory res;
-  auto now = Datetime::Now();
 
-  for (auto& a : basis_) {
-    bool long_term = (a.date.AbsDiffInSeconds(now) > (long_term_in_days * 24 * 3600));
+  auto is_long_term = [&](const InventoryItem& a) {
+    return a.date.AbsDiffInSeconds(as_of) > (long_term_in_days * 24 * 3600);
+  };
+
+  if (method_ == LotMethod::AverageCost) {
+    // split the pool cost over the lots by amount, the last lot gets the rest
+    // so that the costs add up to the pool cost
+    Amount cost_left = pool_cost_;
+    for (size_t i = 0; i < basis_.size(); ++i) {
+      auto& a = basis_[i];
+      Amount cost = cost_left;
+      if ((i + 1 < basis_.size()) && (pool_amount_ != 0))
+        cost = (pool_cost_ * a.amount) / pool_amount_;
+      cost_left -= cost;
 
-    (long_term ? res.long_term : res.short_term).amount += a.amount;
-    (long_term ? res.long_term : res.short_term).cost_in_usd += a.cost_in_usd;
+      auto& unsold = is_long_term(a) ? res.long_term : res.short_term;
+      unsold.amount += a.amount;
+      unsold.cost_in_usd += cost;
+      res.total.amount += a.amount;
+      res.total.cost_in_usd += cost;
+    }
+
+    return res;
+  }
+
+  // the lots are in acquisition order, so we only look at the newest lots up
+  // to the first long-term lot before as_of, all older lots are long-term too
+  // and the long-term total is the rest of the unsold total, add returns false
+  // at the first of those lots
+  auto add = [&](const InventoryItem& a) {
+    bool long_term = is_long_term(a);
+    if (long_term && !(as_of < a.date)) return false;
+    if (!long_term) {
+      res.short_term.amount += a.amount;
+      res.short_term.cost_in_usd += a.cost_in_usd;
+    }
+    return true;
+  };
 
-    res.total.amount += a.amount;
-    res.total.cost_in_usd += a.cost_in_usd;
+  if ((method_ == LotMethod::FIFO) || (method_ == LotMethod::LIFO)) {
+    for (auto a = basis_.rbegin(); a != basis_.rend(); ++a) {
+      if (!add(*a)) break;
+    }
+  } else {
+    for (size_t i = lots_.size(); i > 0; --i) {
+      if (used_[i - 1]) continue;
+      if (!add(lots_[i - 1])) break;
+    }
   }
 
+  res.total.amount = unsold_amount_;
+  res.total.cost_in_usd = unsold_cost_;
+  res.long_term.amount = unsold_amount_ - res.short_term.amount;
+  res.long_term.cost_in_usd = unsold_cost_ - res.short_term.cost_in_usd;
   return res;
-}
\ No newline at end of file
+}
+
+Inventory::State Inventory::GetState() const {
+  State state(method_);
+  state.pool_amount = pool_amount_;
+  state.pool_cost = pool_cost_;
+
+  if ((method_ == LotMethod::FIFO) || (method_ == LotMethod::LIFO) ||
+      (method_ == LotMethod::AverageCost)) {
+    state.lots.assign(basis_.begin(), basis_.end());
+    return state;
+  }
+
+  // the heap entries are not in lot order, so look up the cost per unit of
+  // each lot first
+  std::vector<Amount> unit_costs(lots_.size());
+  for (auto& h : heap_) unit_costs[h.second] = h.first;
+
+  for (size_t i = 0; i < lots_.size(); ++i) {
+    if (used_[i]) continue;
+    state.lots.push_back(lots_[i]);
+    if (method_ == LotMethod::HIFO) state.unit_costs.push_back(unit_costs[i]);
+  }
+
+  return state;
+}
@@ -2,17 +2,35 @@
 #define SRC_TAXES_INVENTORY_HPP_
 
 #include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "Amount.hpp"
 #include "Datetime.hpp"
 
+// the order in which a disposal consumes the acquired lots
+enum class LotMethod {
+  FIFO,        // first in, first out
+  LIFO,        // last in, first out
+  HIFO,        // highest cost per unit first
+  SpecificID,  // the lots named by the disposal first, then first in, first out
+  AverageCost  // all lots are one pool at the average cost per unit
+};
+
 struct InventoryItem {
-  InventoryItem(Datetime date, Amount amount, Amount cost_in_usd)
-      : date(date), amount(amount), cost_in_usd(cost_in_usd) {}
+  InventoryItem(Datetime date, Amount amount, Amount cost_in_usd,
+      std::string lot_id = "")
+      : date(date), amount(amount), cost_in_usd(cost_in_usd), lot_id(lot_id) {}
 
   Datetime date;
   Amount amount;
   Amount cost_in_usd;
+
+  // identifies the lot for LotMethod::SpecificID, several lots may have the
+  // same id
+  std::string lot_id;
 };
 
 struct UnsoldInventory {
@@ -25,21 +43,108 @@ struct UnsoldInventory {
 
 class Inventory {
  public:
-  Inventory(bool LIFO) : LIFO_(LIFO) {}
+  // everything needed to restore an inventory, e.g. from a checkpoint
+  struct State {
+    State(LotMethod method) : method(method), pool_amount(0), pool_cost(0) {}
+
+    LotMethod method;
+
+    // the unconsumed lots in acquisition order
+    std::vector<InventoryItem> lots;
+
+    // HIFO: the cost per unit of each lot that orders the heap
+    std::vector<Amount> unit_costs;
+
+    // AverageCost: the total amount and cost of the pool
+    Amount pool_amount, pool_cost;
+  };
+
+  Inventory(bool LIFO) : Inventory(LIFO ? LotMethod::LIFO : LotMethod::FIFO) {}
+  Inventory(LotMethod method)
+      : method_(method),
+        num_used_(0),
+        next_(0),
+        pool_amount_(0),
+        pool_cost_(0),
+        unsold_amount_(0),
+        unsold_cost_(0) {}
+  explicit Inventory(const State& state);
 
   void Acquire(InventoryItem item);
 
-  // dispose the given amount and return the consumed inventory items
-  std::vector<InventoryItem> Dispose(Amount amount);
+  // dispose the given amount and return the consumed inventory items, with
+  // LotMethod::SpecificID the lots with the given ids are consumed first (ids
+  // that are not in the inventory are ignored), the other methods ignore
+  // lot_ids
+  std::vector<InventoryItem> Dispose(
+      Amount amount, const std::vector<std::string>& lot_ids = {});
+
+  // get the total unsold amount and cost, the lots that are held for more than
+  // long_term_in_days at as_of are long-term
+  UnsoldInventory Unsold(size_t long_term_in_days, Datetime as_of) const;
+  UnsoldInventory Unsold(size_t long_term_in_days) const {
+    return Unsold(long_term_in_days, Datetime::Now());
+  }
 
-  // get the total unsold amount and cost
-  UnsoldInventory Unsold(size_t long_term_in_days) const;
+  // get the state from which an inventory that behaves exactly like this one
+  // can be restored
+  State GetState() const;
 
  private:
-  // true if this is a LIFO inventory, false if it's FIFO
-  bool LIFO_;
+  // consume as much as possible of the remaining amount from the lot and add
+  // the consumed part to consumed, return true if the whole lot was consumed
+  static bool Consume(InventoryItem* lot, Amount* remaining,
+      std::vector<InventoryItem>* consumed);
 
+  // mark the lot with the given index in lots_ as used and remove it from the
+  // lot index
+  void MarkUsed(size_t idx);
+
+  // remove the used lots from lots_ and update the indices of the other lots
+  // in heap_ and lot_index_
+  void Compact();
+
+  // the HIFO heap is ordered by cost per unit and then by acquisition order,
+  // the cost per unit of a lot is not updated when it is partially consumed
+  // since it stays the same up to rounding
+  using HeapEntry = std::pair<Amount, size_t>;
+  static bool LowerPriority(const HeapEntry& a, const HeapEntry& b) {
+    if (a.first == b.first) return a.second > b.second;
+    return a.first < b.first;
+  }
+
+  LotMethod method_;
+
+  // FIFO, LIFO, and AverageCost: the unconsumed lots in acquisition order,
+  // with AverageCost the cost of the lots is ignored and only their dates and
+  // amounts are used to determine the holding periods
   std::deque<InventoryItem> basis_;
+
+  // HIFO and SpecificID: the lots in acquisition order, consumed lots are
+  // marked as used and removed once they are more than half of the lots, so
+  // the lots only take space in proportion to the unconsumed ones
+  std::vector<InventoryItem> lots_;
+  std::vector<bool> used_;
+  size_t num_used_;
+
+  // HIFO: the indices of the unused lots in lots_ as a heap
+  std::vector<HeapEntry> heap_;
+
+  // SpecificID: the indices of the unused lots in lots_ by lot id, and the
+  // first lot that may not be used yet, which is where the FIFO part of a
+  // disposal starts, the lots of an id are always used from the oldest one
+  // since both parts of a disposal take the oldest lots first
+  std::unordered_map<std::string, std::deque<size_t>> lot_index_;
+  size_t next_;
+
+  // AverageCost: the total amount and cost of the pool
+  Amount pool_amount_;
+  Amount pool_cost_;
+
+  // all other methods: the total amount and cost of the unconsumed lots, so
+  // that Unsold only has to look at the short-term lots
+  Amount unsold_amount_;
+  Amount unsold_cost_;
 };
 
-#endif  // SRC_TAXES_INVENTORY_HPP_
\ No newline at end of file
+#endif  // SRC_TAXES_INVENTORY_HPP_
@@ -0,0 +1,381 @@
+#include "TaxCheckpoint.hpp"
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include "SQLite.hpp"
+
+namespace {
+
+std::string LotStr(const InventoryItem& lot) {
+  return lot.amount.ToStr() + " acquired " + lot.date.ToStrUTC() + " for " +
+         lot.cost_in_usd.ToStr() + " USD (" + lot.lot_id + ")";
+}
+
+std::string CarryoverStr(const GainLoss& g) {
+  return g.amount.ToStr() + " acquired " + g.acquired.ToStrUTC() +
+         " disposed " + g.disposed.ToStrUTC() + " for " + g.proceeds.ToStr() +
+         " USD at cost " + g.cost.ToStr() + " USD, wash sale loss " +
+         g.wash_sale_loss.ToStr() + " USD, unwashed " +
+         g.unwashed_amount.ToStr();
+}
+
+bool SameLot(const InventoryItem& a, const InventoryItem& b) {
+  return (a.date == b.date) && (a.amount == b.amount) &&
+         (a.cost_in_usd == b.cost_in_usd) && (a.lot_id == b.lot_id);
+}
+
+bool SameCarryover(const GainLoss& a, const GainLoss& b) {
+  return (a.amount == b.amount) && (a.acquired == b.acquired) &&
+         (a.disposed == b.disposed) && (a.proceeds == b.proceeds) &&
+         (a.cost == b.cost) && (a.wash_sale_loss == b.wash_sale_loss) &&
+         (a.unwashed_amount == b.unwashed_amount);
+}
+
+}  // namespace
+
+#define SQL3_FAIL \
+  throw std::runtime_error("Could not open tax checkpoint " + path)
+TaxCheckpoint TaxCheckpoint::Open(const std::string& path, const File& file) {
+  sqlite3* db = nullptr;
+  if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) !=
+      SQLITE_OK) {
+    printf("ERROR: Could not open tax checkpoint '%s' for reading: %s\n",
+        path.c_str(), sqlite3_errmsg(db));
+    { SQL3_FAIL; }
+  }
+
+  // read the date and settings
+  TaxCheckpoint res(Datetime::Earliest(), LotMethod::FIFO, false);
+  {
+    sqlite3_stmt* stmt = nullptr;
+    SQL3(db, sqlite3_prepare_v2(
+                 db, "SELECT * FROM checkpoint;", -1, &stmt, nullptr));
+
+    int res_step = sqlite3_step(stmt);
+    if (res_step != SQLITE_ROW) SQL3(db, res_step);
+    res.date_ = sqlite3_column_datetime(stmt, 0);
+    res.method_ = (LotMethod)sqlite3_column_int(stmt, 1);
+    res.adjust_for_wash_sale_ = (bool)sqlite3_column_int(stmt, 2);
+    SQL3(db, sqlite3_finalize(stmt));
+  }
+
+  // read the pools, every coin with an inventory has a row
+  std::map<std::string, Inventory::State> states;
+  {
+    sqlite3_stmt* stmt = nullptr;
+    SQL3(db,
+        sqlite3_prepare_v2(db, "SELECT * FROM pools;", -1, &stmt, nullptr));
+
+    int res_step = sqlite3_step(stmt);
+    while (res_step == SQLITE_ROW) {
+      auto& state = states
+                        .insert({sqlite3_column_str(stmt, 0),
+                            Inventory::State(res.method_)})
+                        .first->second;
+      state.pool_amount = sqlite3_column_amount(stmt, 1);
+      state.pool_cost = sqlite3_column_amount(stmt, 2);
+
+      res_step = sqlite3_step(stmt);
+    }
+    if (res_step != SQLITE_DONE) SQL3(db, res_step);
+    SQL3(db, sqlite3_finalize(stmt));
+  }
+
+  // read the lots
+  {
+    sqlite3_stmt* stmt = nullptr;
+    SQL3(db, sqlite3_prepare_v2(db,
+                 "SELECT * FROM lots ORDER BY coin, position;", -1, &stmt,
+                 nullptr));
+
+    int res_step = sqlite3_step(stmt);
+    while (res_step == SQLITE_ROW) {
+      auto& state = states.at(sqlite3_column_str(stmt, 0));
+      state.lots.push_back(InventoryItem(sqlite3_column_datetime(stmt, 2),
+          sqlite3_column_amount(stmt, 3), sqlite3_column_amount(stmt, 4),
+          sqlite3_column_str(stmt, 6)));
+      if (res.method_ == LotMethod::HIFO)
+        state.unit_costs.push_back(sqlite3_column_amount(stmt, 5));
+
+      res_step = sqlite3_step(stmt);
+    }
+    if (res_step != SQLITE_DONE) SQL3(db, res_step);
+    SQL3(db, sqlite3_finalize(stmt));
+  }
+
+  for (auto& it : states)
+    res.inventories_.insert({it.first, Inventory(it.second)});
+
+  // read the dispositions that carry over
+  {
+    sqlite3_stmt* stmt = nullptr;
+    SQL3(db, sqlite3_prepare_v2(db,
+                 "SELECT * FROM carryover ORDER BY coin, position;", -1, &stmt,
+                 nullptr));
+
+    int res_step = sqlite3_step(stmt);
+    while (res_step == SQLITE_ROW) {
+      auto coin_id = sqlite3_column_str(stmt, 0);
+      GainLoss g(file.GetCoin(coin_id), sqlite3_column_amount(stmt, 2),
+          sqlite3_column_datetime(stmt, 3), sqlite3_column_datetime(stmt, 4),
+          sqlite3_column_amount(stmt, 5), sqlite3_column_amount(stmt, 6));
+      g.wash_sale_loss = sqlite3_column_amount(stmt, 7);
+      g.unwashed_amount = sqlite3_column_amount(stmt, 8);
+      res.carryover_[coin_id].push_back(g);
+
+      res_step = sqlite3_step(stmt);
+    }
+    if (res_step != SQLITE_DONE) SQL3(db, res_step);
+    SQL3(db, sqlite3_finalize(stmt));
+  }
+
+  SQL3(db, sqlite3_close_v2(db));
+
+  return res;
+}
+#undef SQL3_FAIL
+
+#define SQL3_FAIL \
+  throw std::runtime_error("Could not save tax checkpoint " + path)
+void TaxCheckpoint::Save(const std::string& path) const {
+  // if a file with this name already exists, move it to <name>_date
+  if (boost::filesystem::exists(path)) {
+    auto backup = path + "_" + Datetime::Now().ToStrLocalFile();
+    boost::filesystem::rename(path, backup);
+  }
+
+  sqlite3* db = nullptr;
+  if (sqlite3_open_v2(path.c_str(), &db,
+          SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK) {
+    printf("ERROR: Could not open tax checkpoint '%s' for writing: %s\n",
+        path.c_str(), sqlite3_errmsg(db));
+    { SQL3_FAIL; }
+  }
+
+  // create tables
+  {
+    SQL3_EXEC(db, R"(
+        CREATE TABLE checkpoint (
+          date                  BLOB,
+          method                INT(4),
+          adjust_for_wash_sale  BOOLEAN
+        );
+      )",
+        nullptr, nullptr);
+
+    SQL3_EXEC(db, R"(
+        CREATE TABLE pools (
+          coin        TEXT PRIMARY KEY,
+          amount      BLOB,
+          cost        BLOB
+        ) WITHOUT ROWID;
+      )",
+        nullptr, nullptr);
+
+    SQL3_EXEC(db, R"(
+        CREATE TABLE lots (
+          coin        TEXT,
+          position    INT8,
+          date        BLOB,
+          amount      BLOB,
+          cost        BLOB,
+          unit_cost   BLOB,
+          lot_id      TEXT,
+          PRIMARY KEY (coin, position)
+        ) WITHOUT ROWID;
+      )",
+        nullptr, nullptr);
+
+    SQL3_EXEC(db, R"(
+        CREATE TABLE carryover (
+          coin            TEXT,
+          position        INT8,
+          amount          BLOB,
+          acquired        BLOB,
+          disposed        BLOB,
+          proceeds        BLOB,
+          cost            BLOB,
+          wash_sale_loss  BLOB,
+          unwashed_amount BLOB,
+          PRIMARY KEY (coin, position)
+        ) WITHOUT ROWID;
+      )",
+        nullptr, nullptr);
+  }
+
+  // do all inserts inside a transaction, otherwise they're VERY slow
+  SQL3_EXEC(db, "BEGIN TRANSACTION;", nullptr, nullptr);
+
+  // write the date and settings
+  {
+    sqlite3_stmt* stmt = nullptr;
+    SQL3(db, sqlite3_prepare_v2(db, "INSERT INTO checkpoint VALUES (?, ?, ?);",
+                 -1, &stmt, nullptr));
+    SQL3(db, sqlite3_bind_datetime(stmt, 1, date_));
+    SQL3(db, sqlite3_bind_int(stmt, 2, (int)method_));
+    SQL3(db, sqlite3_bind_int(stmt, 3, (int)adjust_for_wash_sale_));
+
+    int res = sqlite3_step(stmt);
+    if (res != SQLITE_DONE) SQL3(db, res);
+    SQL3(db, sqlite3_finalize(stmt));
+  }
+
+  // write the pools and lots
+  {
+    sqlite3_stmt* pool_stmt = nullptr;
+    sqlite3_stmt* lot_stmt = nullptr;
+    SQL3(db, sqlite3_prepare_v2(db, "INSERT INTO pools VALUES (?, ?, ?);", -1,
+                 &pool_stmt, nullptr));
+    SQL3(db, sqlite3_prepare_v2(db,
+                 "INSERT INTO lots VALUES (?, ?, ?, ?, ?, ?, ?);", -1,
+                 &lot_stmt, nullptr));
+
+    for (auto& it : inventories_) {
+      auto state = it.second.GetState();
+
+      SQL3(db, sqlite3_reset(pool_stmt));
+      SQL3(db, sqlite3_bind_str(pool_stmt, 1, it.first));
+      SQL3(db, sqlite3_bind_amount(pool_stmt, 2, state.pool_amount));
+      SQL3(db, sqlite3_bind_amount(pool_stmt, 3, state.pool_cost));
+
+      int res = sqlite3_step(pool_stmt);
+      if (res != SQLITE_DONE) SQL3(db, res);
+
+      for (size_t i = 0; i < state.lots.size(); ++i) {
+        auto& lot = state.lots[i];
+        Amount unit_cost =
+            (state.unit_costs.size() > 0) ? state.unit_costs[i] : Amount(0);
+
+        SQL3(db, sqlite3_reset(lot_stmt));
+        SQL3(db, sqlite3_bind_str(lot_stmt, 1, it.first));
+        SQL3(db, sqlite3_bind_int64(lot_stmt, 2, i));
+        SQL3(db, sqlite3_bind_datetime(lot_stmt, 3, lot.date));
+        SQL3(db, sqlite3_bind_amount(lot_stmt, 4, lot.amount));
+        SQL3(db, sqlite3_bind_amount(lot_stmt, 5, lot.cost_in_usd));
+        SQL3(db, sqlite3_bind_amount(lot_stmt, 6, unit_cost));
+        SQL3(db, sqlite3_bind_str(lot_stmt, 7, lot.lot_id));
+
+        res = sqlite3_step(lot_stmt);
+        if (res != SQLITE_DONE) SQL3(db, res);
+      }
+    }
+
+    SQL3(db, sqlite3_finalize(pool_stmt));
+    SQL3(db, sqlite3_finalize(lot_stmt));
+  }
+
+  // write the dispositions that carry over
+  {
+    sqlite3_stmt* stmt = nullptr;
+    SQL3(db, sqlite3_prepare_v2(db,
+                 "INSERT INTO carryover VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);", -1,
+                 &stmt, nullptr));
+
+    for (auto& it : carryover_) {
+      for (size_t i = 0; i < it.second.size(); ++i) {
+        auto& g = it.second[i];
+
+        SQL3(db, sqlite3_reset(stmt));
+        SQL3(db, sqlite3_bind_str(stmt, 1, it.first));
+        SQL3(db, sqlite3_bind_int64(stmt, 2, i));
+        SQL3(db, sqlite3_bind_amount(stmt, 3, g.amount));
+        SQL3(db, sqlite3_bind_datetime(stmt, 4, g.acquired));
+        SQL3(db, sqlite3_bind_datetime(stmt, 5, g.disposed));
+        SQL3(db, sqlite3_bind_amount(stmt, 6, g.proceeds));
+        SQL3(db, sqlite3_bind_amount(stmt, 7, g.cost));
+        SQL3(db, sqlite3_bind_amount(stmt, 8, g.wash_sale_loss));
+        SQL3(db, sqlite3_bind_amount(stmt, 9, g.unwashed_amount));
+
+        int res = sqlite3_step(stmt);
+        if (res != SQLITE_DONE) SQL3(db, res);
+      }
+    }
+
+    SQL3(db, sqlite3_finalize(stmt));
+  }
+
+  SQL3_EXEC(db, "END TRANSACTION;", nullptr, nullptr);
+  SQL3(db, sqlite3_close_v2(db));
+}
+#undef SQL3_FAIL
+
+std::vector<std::string> TaxCheckpoint::Differences(
+    const TaxCheckpoint& other) const {
+  std::vector<std::string> res;
+
+  if (date_ != other.date_)
+    res.push_back("date " + date_.ToStrUTC() + " instead of " +
+                  other.date_.ToStrUTC());
+  if (method_ != other.method_)
+    res.push_back("lot method " + std::to_string((int)method_) +
+                  " instead of " + std::to_string((int)other.method_));
+  if (adjust_for_wash_sale_ != other.adjust_for_wash_sale_)
+    res.push_back(std::string("wash sales ") +
+                  (adjust_for_wash_sale_ ? "adjusted" : "not adjusted") +
+                  " instead of " +
+                  (other.adjust_for_wash_sale_ ? "adjusted" : "not adjusted"));
+
+  std::set<std::string> coin_ids;
+  for (auto& it : inventories_) coin_ids.insert(it.first);
+  for (auto& it : other.inventories_) coin_ids.insert(it.first);
+  for (auto& it : carryover_) coin_ids.insert(it.first);
+  for (auto& it : other.carryover_) coin_ids.insert(it.first);
+
+  auto get_state = [](const TaxCheckpoint& c, const std::string& coin_id) {
+    auto itm = c.inventories_.find(coin_id);
+    if (itm == c.inventories_.end()) return Inventory::State(c.method_);
+    return itm->second.GetState();
+  };
+
+  const std::vector<GainLoss> none;
+  auto get_carryover = [&](const TaxCheckpoint& c, const std::string& coin_id)
+      -> const std::vector<GainLoss>& {
+    auto itm = c.carryover_.find(coin_id);
+    return (itm == c.carryover_.end()) ? none : itm->second;
+  };
+
+  for (auto& coin_id : coin_ids) {
+    auto a = get_state(*this, coin_id);
+    auto b = get_state(other, coin_id);
+
+    if (a.lots.size() != b.lots.size())
+      res.push_back(coin_id + ": " + std::to_string(a.lots.size()) +
+                    " open lots instead of " + std::to_string(b.lots.size()));
+
+    for (size_t i = 0; i < std::min(a.lots.size(), b.lots.size()); ++i) {
+      if (!SameLot(a.lots[i], b.lots[i]))
+        res.push_back(coin_id + ": lot " + std::to_string(i) + " is " +
+                      LotStr(a.lots[i]) + " instead of " + LotStr(b.lots[i]));
+    }
+
+    if (a.unit_costs != b.unit_costs)
+      res.push_back(coin_id + ": different HIFO costs per unit");
+
+    if ((a.pool_amount != b.pool_amount) || (a.pool_cost != b.pool_cost))
+      res.push_back(coin_id + ": pool of " + a.pool_amount.ToStr() + " for " +
+                    a.pool_cost.ToStr() + " USD instead of " +
+                    b.pool_amount.ToStr() + " for " + b.pool_cost.ToStr() +
+                    " USD");
+
+    auto& ca = get_carryover(*this, coin_id);
+    auto& cb = get_carryover(other, coin_id);
+
+    if (ca.size() != cb.size())
+      res.push_back(coin_id + ": " + std::to_string(ca.size()) +
+                    " carried over dispositions instead of " +
+                    std::to_string(cb.size()));
+
+    for (size_t i = 0; i < std::min(ca.size(), cb.size()); ++i) {
+      if (!SameCarryover(ca[i], cb[i]))
+        res.push_back(coin_id + ": carried over disposition " +
+                      std::to_string(i) + " is " + CarryoverStr(ca[i]) +
+                      " instead of " + CarryoverStr(cb[i]));
+    }
+  }
+
+  return res;
+}
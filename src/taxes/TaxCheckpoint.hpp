@@ -0,0 +1,51 @@
+#ifndef SRC_TAXES_TAXCHECKPOINT_HPP_
+#define SRC_TAXES_TAXCHECKPOINT_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Datetime.hpp"
+#include "File.hpp"
+#include "taxes/Inventory.hpp"
+#include "taxes/Taxes.hpp"
+
+// The open lots of all coins and the dispositions whose losses can still be
+// washed at the start of a day, usually the first day of a tax year. A
+// checkpoint is made with Taxes::MakeCheckpoint and saved to its own file next
+// to the ledger, so that later years can be computed from the checkpoint and
+// the transactions since the checkpoint instead of all transactions ever.
+class TaxCheckpoint {
+ public:
+  // a checkpoint without any lots or dispositions
+  TaxCheckpoint(Datetime date, LotMethod method, bool adjust_for_wash_sale)
+      : date_(date),
+        method_(method),
+        adjust_for_wash_sale_(adjust_for_wash_sale) {}
+
+  // the coins of the dispositions are looked up in file
+  static TaxCheckpoint Open(const std::string& path, const File& file);
+  void Save(const std::string& path) const;
+
+  // the checkpoint contains the events before this date
+  Datetime Date() const { return date_; }
+  LotMethod Method() const { return method_; }
+  bool AdjustForWashSale() const { return adjust_for_wash_sale_; }
+
+  // describe the differences to other checkpoint, one per entry, a coin that
+  // is missing in one checkpoint is the same as a coin without lots
+  std::vector<std::string> Differences(const TaxCheckpoint& other) const;
+
+ private:
+  friend class Taxes;
+
+  Datetime date_;
+  LotMethod method_;
+  bool adjust_for_wash_sale_;
+
+  // the open lots and the dispositions that carry over by coin id
+  std::map<std::string, Inventory> inventories_;
+  std::map<std::string, std::vector<GainLoss>> carryover_;
+};
+
+#endif  // SRC_TAXES_TAXCHECKPOINT_HPP_
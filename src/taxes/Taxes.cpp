@@ -1,647 +1,879 @@
 #include "Taxes.hpp"
 
 #include <algorithm>
-#include <list>
+#include <exception>
+#include <functional>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "Inventory.hpp"
+#include "TaxCheckpoint.hpp"
+#include "WashSales.hpp"
 
+#include "Parallel.hpp"
 #include "prices/PriceSource.hpp"
 
-Taxes::Taxes(const File& file, Datetime until, Accnt assets, Accnt wallets,
-    Accnt ecr20_account, Accnt exchanges, Accnt equity, Accnt expenses,
-    Accnt expense_mining_fees, Accnt expense_trading_fees,
-    Accnt expense_transaction_fees, Accnt income_other, Accnt income_mining,
-    Accnt income_trade, const std::vector<std::string>& ignore_txns) {
-  // collect all mining income from the same day into one tax event
-  std::unordered_map<std::string, std::map<Datetime, TaxEvent>> mining;
+namespace {
+
+// the roles of the accounts given to Taxes, an account has all the roles of
+// the accounts it is contained in
+enum Role : uint16_t {
+  Asset = 1 << 0,
+  Wallet = 1 << 1,
+  ECR20 = 1 << 2,
+  Exchange = 1 << 3,
+  Equity = 1 << 4,
+  Expense = 1 << 5,
+  MiningFee = 1 << 6,
+  TradingFee = 1 << 7,
+  TransactionFee = 1 << 8,
+  OtherIncome = 1 << 9,
+  MiningIncome = 1 << 10,
+  TradeIncome = 1 << 11
+};
+
+// the amounts of all splits of a transaction in the same account and coin
+// combined into one
+struct TaxSplit {
+  std::shared_ptr<const Account> account_;
+  std::shared_ptr<const Coin> coin_;
+  Amount amount_;
+  uint16_t roles_;
+
+  bool Is(uint16_t role) const { return (roles_ & role) != 0; }
+};
+
+// the roles of all accounts of the file by account index
+std::vector<uint16_t> MakeRoleTable(const File& file,
+    const std::vector<std::pair<Role, const Taxes::Accnts*>>& role_accounts) {
+  UUIDMap<uint16_t> direct;
+  for (auto& r : role_accounts) {
+    for (auto& a : *r.second) {
+      if (a != nullptr) direct[a->Id()] |= r.first;
+    }
+  }
 
-  // auto liabilities = file.GetAccount("Liabilities");
+  std::vector<uint16_t> roles(file.Accounts().size(), 0);
+  for (auto& entry : file.Accounts()) {
+    uint16_t r = 0;
+    for (std::shared_ptr<const Account> a = entry.second; a != nullptr;
+         a = a->Parent()) {
+      auto it = direct.find(a->Id());
+      if (it != direct.end()) r |= it->second;
+    }
+    roles[entry.second->Index()] = r;
 
-  std::unordered_set<std::string> ignore;
-  for (const auto& s : ignore_txns) ignore.insert(s);
+    // the full name is cached on first use, make sure that happens here and
+    // not concurrently in the extraction threads
+    entry.second->FullName();
+  }
 
-  try {
-    // loop over all transactions and figure out what kind of tax event it is,
-    // some transactions might be multiple tax events (e.g. trading one crypto
-    // currency against another results in a tax event for both, or a trade
-    // against USD with a fee results in a trade event and a spend event (the
-    // fee is spent))
-    for (auto itm : file.Transactions()) {
-      auto txn = itm.second;
-      if (txn->Date() > until) continue;
-      if (ignore.count(txn->Import_id()) > 0) continue;
-
-      // copy the splits of this transaction into a list and combine splits of
-      // the same coin in the same account, we will erase splits from this list
-      // as we consume splits
-      std::list<std::shared_ptr<ProtoSplit>> splits;
-
-      for (auto& in_sp : txn->Splits()) {
-        // check if a split with the same account and coin already exists
-        bool already_exists = false;
-        for (auto& sp : splits) {
-          if ((in_sp->GetAccount()->Id() == sp->account_->Id()) &&
-              (in_sp->GetCoin()->Id() == sp->coin_->Id())) {
-            sp->amount_ += in_sp->GetAmount();
-            already_exists = true;
-            break;
-          }
-        }
+  return roles;
+}
 
-        if (!already_exists) {
-          splits.push_back(
-              std::shared_ptr<ProtoSplit>(new ProtoSplit(in_sp->GetAccount(),
-                  "", in_sp->GetAmount(), in_sp->GetCoin(), "")));
-        }
+// a transaction that doesn't fit any kind of tax event, the transaction is
+// printed when the error is reported
+class TransactionError : public std::runtime_error {
+ public:
+  TransactionError(
+      std::shared_ptr<const Transaction> txn, const std::string& what)
+      : std::runtime_error(what), txn_(txn) {}
+
+  std::shared_ptr<const Transaction> Txn() const { return txn_; }
+
+ private:
+  std::shared_ptr<const Transaction> txn_;
+};
+
+// a daily price by coin id and day (as used in DailyData)
+using PriceKey = std::pair<std::string, int64_t>;
+
+// the most coins whose prices are fetched at the same time, the price API
+// limits how many requests it answers
+const size_t max_fetch_threads = 4;
+
+// Turns transactions into tax events. The transactions are split into
+// contiguous chunks that are processed in parallel, each chunk has its own
+// extractor and the events of the extractors are appended in chunk order, so
+// the events of each coin are in the same order as if all transactions were
+// processed by a single extractor.
+class EventExtractor {
+ public:
+  EventExtractor(const File& file, const std::vector<uint16_t>& roles,
+      const std::map<PriceKey, Amount>* fetched)
+      : file_(file), roles_(roles), fetched_(fetched), txn_(nullptr) {}
+
+  // figure out what kind of tax event the transaction is and add its events,
+  // some transactions might be multiple tax events (e.g. trading one crypto
+  // currency against another results in a tax event for both, or a trade
+  // against USD with a fee results in a trade event and a spend event (the
+  // fee is spent))
+  void Add(std::shared_ptr<const Transaction> txn);
+
+  // the events by coin id in the order of the transactions
+  std::unordered_map<std::string, std::vector<TaxEvent>> events_;
+
+  // all mining income from the same day is collected into one tax event
+  std::unordered_map<std::string, std::map<Datetime, TaxEvent>> mining_;
+
+  // the prices that were needed but are neither in memory nor fetched
+  std::map<PriceKey, std::shared_ptr<const Coin>> missing_;
+
+ private:
+  // prices are never fetched here, so all threads can look them up at the
+  // same time, a price that is not available yet is recorded as missing and
+  // counts as 0 (none of the decisions depend on prices), the events are then
+  // extracted again once the missing prices have been fetched
+  Amount Price(Datetime time, std::shared_ptr<const Coin> coin) {
+    Amount price;
+    if (file_.FindHistoricUSDPrice(time, coin, &price)) return price;
+
+    PriceKey key(coin->Id(), time.DailyDataDay());
+    auto itm = fetched_->find(key);
+    if (itm != fetched_->end()) return itm->second;
+
+    missing_.insert({key, coin});
+    return 0;
+  }
+
+  // remove the first split with the role and return it, or return nullptr if
+  // there is none, the returned split is overwritten by the next call
+  const TaxSplit* TakeFirst(uint16_t role);
+
+  // add an event of the current transaction
+  void Push(const std::string& coin_id, TaxEvent event) {
+    event.import_id = txn_->Import_id();
+    events_[coin_id].push_back(event);
+  }
+
+  const File& file_;
+  const std::vector<uint16_t>& roles_;
+  const std::map<PriceKey, Amount>* fetched_;
+
+  // the transaction that is being added
+  const Transaction* txn_;
+
+  // the combined splits of the current transaction, we will erase splits from
+  // this list as we consume splits
+  std::vector<TaxSplit> splits_;
+  TaxSplit taken_;
+};
+
+const TaxSplit* EventExtractor::TakeFirst(uint16_t role) {
+  for (auto it = splits_.begin(); it != splits_.end(); ++it) {
+    if (it->Is(role)) {
+      taken_ = *it;
+      splits_.erase(it);
+      return &taken_;
+    }
+  }
+  return nullptr;
+}
+
+void EventExtractor::Add(std::shared_ptr<const Transaction> txn) {
+  txn_ = txn.get();
+
+  // copy the splits of this transaction into a flat list and combine
+  // splits of the same coin in the same account
+  splits_.clear();
+  uint16_t txn_roles = 0;
+  for (auto& in_sp : txn->Splits()) {
+    auto account = in_sp->GetAccount();
+    auto in_coin = in_sp->GetCoin();
+
+    // check if a split with the same account and coin already exists
+    bool already_exists = false;
+    for (auto& sp : splits_) {
+      if ((account->Id() == sp.account_->Id()) &&
+          (in_coin->Id() == sp.coin_->Id())) {
+        sp.amount_ += in_sp->GetAmount();
+        already_exists = true;
+        break;
       }
+    }
 
-      auto coin = txn->GetCoin();
+    if (!already_exists) {
+      uint16_t r = roles_[account->Index()];
+      splits_.push_back({account, in_coin, in_sp->GetAmount(), r});
+      txn_roles |= r;
+    }
+  }
 
-      // check if this is mining income
-      {
-        std::shared_ptr<const ProtoSplit> mining_income_split = nullptr;
-        for (auto it = splits.begin(); it != splits.end(); ++it) {
-          if ((*it)->account_->IsContainedIn(income_mining)) {
-            mining_income_split = *it;
-            splits.erase(it);
-            break;
-          }
-        }
+  auto coin = txn->GetCoin();
 
-        if (mining_income_split != nullptr) {
-          // this is mining income, make sure this is a single-coin transaction
-          if (coin == nullptr) {
-            txn->Print(true);
-            throw std::runtime_error("Got a multi-coin mining transaction");
-          }
+  // check if this is mining income
+  if (txn_roles & MiningIncome) {
+    TakeFirst(MiningIncome);
 
-          // we expect to have an asset split and maybe a mining fee split
-          std::shared_ptr<const ProtoSplit> asset = nullptr;
-          std::shared_ptr<const ProtoSplit> fee = nullptr;
+    // this is mining income, make sure this is a single-coin transaction
+    if (coin == nullptr) {
+      throw TransactionError(txn, "Got a multi-coin mining transaction");
+    }
 
-          auto it = splits.begin();
-          while (it != splits.end()) {
-            if ((*it)->account_->IsContainedIn(assets)) {
-              asset = *it;
-              it = splits.erase(it);
-              continue;
-            }
-            if ((*it)->account_->IsContainedIn(expense_mining_fees)) {
-              fee = *it;
-              it = splits.erase(it);
-              continue;
-            }
-            ++it;
-          }
+    // we expect to have an asset split and maybe a mining fee split
+    bool has_asset = false;
+    TaxSplit asset;
 
-          if (splits.size() > 0) {
-            txn->Print(true);
-            throw std::runtime_error("Leftover splits in mining transaction");
-          }
+    auto it = splits_.begin();
+    while (it != splits_.end()) {
+      if (it->Is(Asset)) {
+        asset = *it;
+        has_asset = true;
+        it = splits_.erase(it);
+        continue;
+      }
+      if (it->Is(MiningFee)) {
+        it = splits_.erase(it);
+        continue;
+      }
+      ++it;
+    }
 
-          if (asset == nullptr) {
-            txn->Print(true);
-            throw std::runtime_error("No asset split in mining transaction");
-          }
+    if (splits_.size() > 0) {
+      throw TransactionError(txn, "Leftover splits in mining transaction");
+    }
 
-          Amount amt = asset->amount_;
-          if (amt <= 0) {
-            txn->Print(true);
-            throw std::runtime_error("Expect positive mining income");
-          }
+    if (!has_asset) {
+      throw TransactionError(txn, "No asset split in mining transaction");
+    }
 
-          // we ignore the fee since that is not actually spent, we just acquire
-          // the net mining income
-          auto day = txn->Date().EndOfDay();
-          if (mining[coin->Id()].count(day) == 0) {
-            mining[coin->Id()].insert(
-                {{day, TaxEvent(day, 0, 0, EventType::MiningIncome)}});
-          }
-          mining[coin->Id()].at(day).amount += amt;
-          mining[coin->Id()].at(day).amount_usd +=
-              amt * file.GetHistoricUSDPrice(day, coin);
+    Amount amt = asset.amount_;
+    if (amt <= 0) {
+      throw TransactionError(txn, "Expect positive mining income");
+    }
 
-          // done with this transaction
-          continue;
-        }
-      }  // mining transaction
-
-      // check if this is other income
-      {
-        std::shared_ptr<const ProtoSplit> other_income_split = nullptr;
-        for (auto it = splits.begin(); it != splits.end(); ++it) {
-          if ((*it)->account_->IsContainedIn(income_other)) {
-            other_income_split = *it;
-            splits.erase(it);
-            break;
-          }
-        }
+    // we ignore the fee since that is not actually spent, we just acquire
+    // the net mining income
+    auto day = txn->Date().EndOfDay();
+    if (mining_[coin->Id()].count(day) == 0) {
+      mining_[coin->Id()].insert(
+          {{day, TaxEvent(day, 0, 0, EventType::MiningIncome)}});
+    }
+    mining_[coin->Id()].at(day).amount += amt;
+    mining_[coin->Id()].at(day).amount_usd += amt * Price(day, coin);
 
-        if (other_income_split != nullptr) {
-          // this is other income, make sure this is a single-coin
-          // transaction
-          if (coin == nullptr) {
-            txn->Print(true);
-            throw std::runtime_error(
-                "Got a multi-coin other income transaction");
-          }
+    // done with this transaction
+    return;
+  }  // mining transaction
 
-          // we expect to have an asset split and maybe a transaction fee split
-          std::shared_ptr<const ProtoSplit> asset = nullptr;
-          std::shared_ptr<const ProtoSplit> fee = nullptr;
+  // check if this is other income
+  if (txn_roles & OtherIncome) {
+    TakeFirst(OtherIncome);
 
-          auto it = splits.begin();
-          while (it != splits.end()) {
-            if ((*it)->account_->IsContainedIn(assets)) {
-              asset = *it;
-              it = splits.erase(it);
-              continue;
-            }
-            if ((*it)->account_->IsContainedIn(expense_transaction_fees)) {
-              fee = *it;
-              it = splits.erase(it);
-              continue;
-            }
-            ++it;
-          }
+    // this is other income, make sure this is a single-coin transaction
+    if (coin == nullptr) {
+      throw TransactionError(txn, "Got a multi-coin other income transaction");
+    }
 
-          if (splits.size() > 0) {
-            txn->Print(true);
-            throw std::runtime_error(
-                "Leftover splits in other income transaction");
-          }
+    // we expect to have an asset split and maybe a transaction fee split
+    bool has_asset = false;
+    TaxSplit asset;
 
-          if (asset == nullptr) {
-            txn->Print(true);
-            throw std::runtime_error(
-                "No asset split in other income transaction");
-          }
+    auto it = splits_.begin();
+    while (it != splits_.end()) {
+      if (it->Is(Asset)) {
+        asset = *it;
+        has_asset = true;
+        it = splits_.erase(it);
+        continue;
+      }
+      if (it->Is(TransactionFee)) {
+        it = splits_.erase(it);
+        continue;
+      }
+      ++it;
+    }
+
+    if (splits_.size() > 0) {
+      throw TransactionError(
+          txn, "Leftover splits in other income transaction");
+    }
 
-          Amount amt = asset->amount_;
-          // if (amt <= 0) {
-          //   txn->Print(true);
-          //   throw std::runtime_error("Expect positive other income");
-          // }
+    if (!has_asset) {
+      throw TransactionError(txn, "No asset split in other income transaction");
+    }
 
-          // we ignore the fee since that is not actually spent, we just acquire
-          // the net other income at its USD value at the time of the income
-          Amount amt_usd = amt * file.GetHistoricUSDPrice(txn->Date(), coin);
-          events_[coin->Id()].push_back(
-              TaxEvent(txn->Date(), amt, amt_usd, EventType::OtherIncome));
+    Amount amt = asset.amount_;
+    // if (amt <= 0) {
+    //   txn->Print(true);
+    //   throw std::runtime_error("Expect positive other income");
+    // }
+
+    // we ignore the fee since that is not actually spent, we just acquire
+    // the net other income at its USD value at the time of the income
+    Amount amt_usd = amt * Price(txn->Date(), coin);
+    Push(coin->Id(),
+        TaxEvent(txn->Date(), amt, amt_usd, EventType::OtherIncome));
+
+    // done with this transaction
+    return;
+  }  // other income
+
+  // check if this is trade income
+  if (txn_roles & TradeIncome) {
+    // this is trade income
+    TaxSplit trade_income_split = *TakeFirst(TradeIncome);
+
+    // first find fee
+    bool has_fee = false;
+    TaxSplit fee_split;
+    if (auto fee = TakeFirst(TradingFee)) {
+      fee_split = *fee;
+      has_fee = true;
+    }
+
+    if (has_fee && (fee_split.amount_ <= 0)) {
+      throw TransactionError(txn, "Expect a positive trading fee");
+    }
 
-          // done with this transaction
+    // find fee match split and make sure all remaining splits are in the
+    // exchange account
+    bool has_fee_match = false;
+    auto it = splits_.begin();
+    while (it != splits_.end()) {
+      if (!it->Is(Exchange)) {
+        throw TransactionError(
+            txn, "Expected exchange split in trade transaction");
+      }
+      if (has_fee) {
+        if ((it->coin_->Id() == fee_split.coin_->Id()) &&
+            (it->amount_ == -fee_split.amount_)) {
+          has_fee_match = true;
+          it = splits_.erase(it);
           continue;
         }
-      }  // other income
-
-      // check if this is trade income
-      {
-        std::shared_ptr<const ProtoSplit> trade_income_split = nullptr;
-        for (auto it = splits.begin(); it != splits.end(); ++it) {
-          if ((*it)->account_->IsContainedIn(income_trade)) {
-            trade_income_split = *it;
-            splits.erase(it);
-            break;
-          }
-        }
+      }
+      ++it;
+    }
 
-        if (trade_income_split != nullptr) {
-          // this is trade income
-
-          // first find fee
-          std::shared_ptr<const ProtoSplit> fee_split = nullptr;
-          auto it = splits.begin();
-          while (it != splits.end()) {
-            if ((*it)->account_->IsContainedIn(expense_trading_fees)) {
-              fee_split = *it;
-              it = splits.erase(it);
-              break;
-            }
-            ++it;
-          }
+    if (splits_.size() != 1) {
+      throw TransactionError(
+          txn, "Expected 1 split for a trade income transaction");
+    }
 
-          if ((fee_split != nullptr) && (fee_split->amount_ <= 0)) {
-            txn->Print(true);
-            throw std::runtime_error("Expect a positive trading fee");
-          }
+    auto date = txn->Date();
+    Amount fee_usd = 0;
 
-          // find fee match split and make sure all remaining splits are in the
-          // exchange account
-          std::shared_ptr<const ProtoSplit> fee_match_split = nullptr;
-          it = splits.begin();
-          while (it != splits.end()) {
-            if (!(*it)->account_->IsContainedIn(exchanges)) {
-              txn->Print(true);
-              throw std::runtime_error(
-                  "Expected exchange split in trade transaction");
-            }
-            if (fee_split != nullptr) {
-              if (((*it)->coin_->Id() == fee_split->coin_->Id()) &&
-                  ((*it)->amount_ == -fee_split->amount_)) {
-                fee_match_split = *it;
-                it = splits.erase(it);
-                continue;
-              }
-            }
-            ++it;
-          }
+    // get the USD amount from the sell split by default
+    Amount profit_usd =
+        trade_income_split.amount_ * Price(date, trade_income_split.coin_);
 
-          if (splits.size() != 1) {
-            txn->Print(true);
-            throw std::runtime_error(
-                "Expected 1 split for a trade income transaction");
-          }
+    if (has_fee) {
+      if (fee_split.coin_->Id() == trade_income_split.coin_->Id()) {
+        // make sure we don't have a fee match, don't need to treat the
+        // fee separately, since it's already accounted for in the buy or
+        // sell split
+        if (has_fee_match) {
+          throw TransactionError(txn, "Unexpected fee match split");
+        }
+      } else {
+        // make sure we have a fee match
+        if (!has_fee_match) {
+          throw TransactionError(txn, "Expected fee match split");
+        }
+        // the fee is not accounted for in the buy or sell split,
+        // determine its USD value and spend the fee coin
+        fee_usd = fee_split.amount_ * Price(date, fee_split.coin_);
+        Push(fee_split.coin_->Id(),
+            TaxEvent(date, fee_split.amount_, fee_usd,
+                EventType::SpentTradingFee));
+      }
+    }
 
-          auto date = txn->Date();
-          Amount fee_usd = 0;
-
-          // get the USD amount from the sell split by default
-          Amount profit_usd =
-              trade_income_split->amount_ *
-              file.GetHistoricUSDPrice(date, trade_income_split->coin_);
-
-          if (fee_split != nullptr) {
-            if (fee_split->coin_->Id() == trade_income_split->coin_->Id()) {
-              // make sure we don't have a fee match, don't need to treat the
-              // fee separately, since it's already accounted for in the buy or
-              // sell split
-              if (fee_match_split != nullptr) {
-                txn->Print(true);
-                throw std::runtime_error("Unexpected fee match split");
-              }
-            } else {
-              // make sure we have a fee match
-              if (fee_match_split == nullptr) {
-                txn->Print(true);
-                throw std::runtime_error("Expected fee match split");
-              }
-              // the fee is not accounted for in the buy or sell split,
-              // determine its USD value and spend the fee coin
-              fee_usd = fee_split->amount_ *
-                        file.GetHistoricUSDPrice(date, fee_split->coin_);
-              events_[fee_split->coin_->Id()].push_back(TaxEvent(date,
-                  fee_split->amount_, fee_usd, EventType::SpentTradingFee));
-            }
-          }
+    // if the fee was paid in a 3rd coin (fee_usd > 0), account for the
+    // fee in the basis (i.e. cost) of the coin that was bought
+    Push(trade_income_split.coin_->Id(),
+        TaxEvent(date, trade_income_split.amount_, profit_usd - fee_usd,
+            EventType::TradeIncome));
+
+    // done with this transaction
+    return;
+  }  // trade income
+
+  // if this is a single coin transaction, record what is spent
+  // also if this is a transfer transaction involving an ECR20 token with
+  // the fee paid in ETH, record the fee
+  {
+    bool decrease_ECR20 = false;
+    bool spend_ETH_txn_fee = false;
+    if (txn_roles & (ECR20 | TransactionFee)) {
+      for (auto& s : splits_) {
+        if (s.Is(ECR20) && (s.amount_ < 0)) decrease_ECR20 = true;
+        if (s.Is(TransactionFee) && (s.amount_ > 0) &&
+            (s.coin_->Symbol() == "ETH")) {
+          spend_ETH_txn_fee = true;
+          coin = s.coin_;
+        }
+      }
+    }
 
-          // if the fee was paid in a 3rd coin (fee_usd > 0), account for the
-          // fee in the basis (i.e. cost) of the coin that was bought
-          events_[trade_income_split->coin_->Id()].push_back(
-              TaxEvent(date, trade_income_split->amount_, profit_usd - fee_usd,
-                  EventType::TradeIncome));
+    if ((coin != nullptr) || (decrease_ECR20 && spend_ETH_txn_fee)) {
+      std::vector<TaxSplit> expense_splits;
 
-          // done with this transaction
+      auto it = splits_.begin();
+      while (it != splits_.end()) {
+        if (it->Is(Asset | Equity)) {
+          it = splits_.erase(it);
           continue;
         }
-      }  // trade income
-
-      // if this is a single coin transaction, record what is spent
-      // also if this is a transfer transaction involving an ECR20 token with
-      // the fee paid in ETH, record the fee
-      {
-        bool decrease_ECR20 = false;
-        bool spend_ETH_txn_fee = false;
-        for (auto& s : splits) {
-          if (s->account_->IsContainedIn(ecr20_account) && (s->amount_ < 0))
-            decrease_ECR20 = true;
-          if (s->account_->IsContainedIn(expense_transaction_fees) &&
-              (s->amount_ > 0) && (s->coin_->Symbol() == "ETH")) {
-            spend_ETH_txn_fee = true;
-            coin = s->coin_;
-          }
+        if (it->Is(Expense)) {
+          expense_splits.push_back(*it);
+          it = splits_.erase(it);
+          continue;
         }
+        ++it;
+      }
 
-        if ((coin != nullptr) || (decrease_ECR20 && spend_ETH_txn_fee)) {
-          std::vector<std::shared_ptr<const ProtoSplit>> expense_splits;
+      if (splits_.size() > 0) {
+        throw TransactionError(
+            txn, "Leftover splits in single-coin transaction");
+      }
 
-          auto it = splits.begin();
-          while (it != splits.end()) {
-            if ((*it)->account_->IsContainedIn(assets) ||
-                (*it)->account_->IsContainedIn(equity)) {
-              it = splits.erase(it);
-              continue;
-            }
-            if ((*it)->account_->IsContainedIn(expenses)) {
-              expense_splits.push_back(*it);
-              it = splits.erase(it);
-              continue;
-            }
-            ++it;
-          }
+      // make spend events for all expenses, but make sure no expenses are
+      // trading fees or mining fees
+      for (auto& e : expense_splits) {
+        if (e.Is(MiningFee)) {
+          throw TransactionError(txn, "Unexpected mining fee expense");
+        }
 
-          if (splits.size() > 0) {
-            txn->Print(true);
-            throw std::runtime_error(
-                "Leftover splits in single-coin transaction");
-          }
+        auto date = txn->Date();
+        auto amt = e.amount_;
+        auto usd = amt * Price(date, coin);
+
+        if (e.Is(TradingFee)) {
+          // reduce trade income by this trading fee
+          Push(e.coin_->Id(),
+              TaxEvent(date, -amt, -usd, EventType::TradeIncome));
+          std::string memo =
+              txn->Description() + " (" + e.account_->FullName() + ")";
+          Push(coin->Id(),
+              TaxEvent(date, amt, usd, EventType::SpentTradingFee, memo));
+        } else {
+          EventType type = e.Is(TransactionFee)
+                               ? EventType::SpentTransactionFee
+                               : EventType::SpentGeneral;
+          std::string memo =
+              txn->Description() + " (" + e.account_->FullName() + ")";
+          Push(coin->Id(), TaxEvent(date, amt, usd, type, memo));
+        }
+      }
 
-          // make spend events for all expenses, but make sure no expenses are
-          // trading fees or mining fees
-          for (auto& e : expense_splits) {
-            if (e->account_->IsContainedIn(expense_mining_fees)) {
-              txn->Print(true);
-              throw std::runtime_error("Unexpected mining fee expense");
-            }
+      // done with this transaction
+      return;
+    }
+  }  // spending
 
-            auto date = txn->Date();
-            auto amt = e->amount_;
-            auto usd = amt * file.GetHistoricUSDPrice(date, coin);
-
-            if (e->account_->IsContainedIn(expense_trading_fees)) {
-              // reduce trade income by this trading fee
-              events_[e->coin_->Id()].push_back(
-                  TaxEvent(date, -amt, -usd, EventType::TradeIncome));
-              std::string memo =
-                  txn->Description() + " (" + e->account_->FullName() + ")";
-              events_[coin->Id()].push_back(
-                  TaxEvent(date, amt, usd, EventType::SpentTradingFee, memo));
-            } else {
-              EventType type =
-                  e->account_->IsContainedIn(expense_transaction_fees)
-                      ? EventType::SpentTransactionFee
-                      : EventType::SpentGeneral;
-              std::string memo =
-                  txn->Description() + " (" + e->account_->FullName() + ")";
-              events_[coin->Id()].push_back(
-                  TaxEvent(date, amt, usd, type, memo));
-            }
-          }
+  // check if this is spending with a coin conversion
+  if (txn_roles & Wallet) {
+    // There is one split that reduces a wallet account, one that increases
+    // an expense account (which is not a transaction, mining, or trading
+    // fee), and optionally a transaction fee split
+
+    // first find wallet split
+    TaxSplit wallet_split = *TakeFirst(Wallet);
+
+    if (wallet_split.amount_ >= 0) {
+      throw TransactionError(
+          txn, "Expect a negative amount in the wallet split");
+    }
+
+    bool has_fee = false;
+    TaxSplit fee_split;
+    if (auto fee = TakeFirst(TransactionFee)) {
+      fee_split = *fee;
+      has_fee = true;
+    }
+    if (has_fee && (fee_split.amount_ <= 0)) {
+      throw TransactionError(txn, "Expect a positive transaction fee");
+    }
 
-          // done with this transaction
+    // find fee match split if there is one
+    bool has_fee_match = false;
+    if (has_fee) {
+      auto it = splits_.begin();
+      while (it != splits_.end()) {
+        if ((it->coin_->Id() == fee_split.coin_->Id()) &&
+            (it->amount_ == -fee_split.amount_)) {
+          has_fee_match = true;
+          it = splits_.erase(it);
           continue;
         }
-      }  // spending
-
-      // check if this is spending with a coin conversion
-      {
-        // There is one split that reduces a wallet account, one that increases
-        // an expense account (which is not a transaction, mining, or trading
-        // fee), and optionally a transaction fee split
-
-        // first find wallet split
-        std::shared_ptr<const ProtoSplit> wallet_split = nullptr;
-        auto it = splits.begin();
-        while (it != splits.end()) {
-          if ((*it)->account_->IsContainedIn(wallets)) {
-            wallet_split = *it;
-            it = splits.erase(it);
-            break;
-          }
-          ++it;
-        }
+        ++it;
+      }
+    }
 
-        if (wallet_split != nullptr) {
-          if (wallet_split->amount_ >= 0) {
-            txn->Print(true);
-            throw std::runtime_error(
-                "Expect a negative amount in the wallet split");
-          }
+    // there should be one split left now, which is an expense split, but
+    // not transaction, trading, or mining fee
+    if (splits_.size() != 1) {
+      throw TransactionError(
+          txn, "Expected 1 split left in conversion spending");
+    }
 
-          std::shared_ptr<const ProtoSplit> fee_split = nullptr;
-          auto it = splits.begin();
-          while (it != splits.end()) {
-            if ((*it)->account_->IsContainedIn(expense_transaction_fees)) {
-              fee_split = *it;
-              it = splits.erase(it);
-              break;
-            }
-            ++it;
-          }
-          if ((fee_split != nullptr) && (fee_split->amount_ <= 0)) {
-            txn->Print(true);
-            throw std::runtime_error("Expect a positive transaction fee");
-          }
+    // check the expense split
+    auto& expense_split = splits_[0];
+    if (!expense_split.Is(Expense) ||
+        expense_split.Is(TransactionFee | MiningFee | TradingFee) ||
+        (expense_split.amount_ <= 0)) {
+      throw TransactionError(txn, "Couldn't get buy and sell splits");
+    }
 
-          // find fee match split if there is one
-          std::shared_ptr<const ProtoSplit> fee_match_split = nullptr;
-          if (fee_split != nullptr) {
-            it = splits.begin();
-            while (it != splits.end()) {
-              if (((*it)->coin_->Id() == fee_split->coin_->Id()) &&
-                  ((*it)->amount_ == -fee_split->amount_)) {
-                fee_match_split = *it;
-                it = splits.erase(it);
-                continue;
-              }
-              ++it;
-            }
-          }
+    auto date = txn->Date();
+    Amount fee_usd = 0;
+
+    // get the USD amount from the sell split by default
+    Amount amt_usd = -wallet_split.amount_ * Price(date, wallet_split.coin_);
+
+    // unless the buy coin is USD or USDT
+    if (expense_split.coin_->IsUSD())
+      amt_usd = expense_split.amount_;
+    else if (expense_split.coin_->Id() == "tether")
+      amt_usd = expense_split.amount_ * Price(date, expense_split.coin_);
+
+    if (has_fee) {
+      if ((fee_split.coin_->Id() == expense_split.coin_->Id()) ||
+          (fee_split.coin_->Id() == wallet_split.coin_->Id())) {
+        // make sure we don't have a fee match, don't need to treat the
+        // fee separately, since it's already accounted for in the buy or
+        // sell split
+        if (has_fee_match) {
+          throw TransactionError(txn, "Unexpected fee match split");
+        }
+      } else {
+        // make sure we have a fee match
+        if (!has_fee_match) {
+          throw TransactionError(txn, "Expected fee match split");
+        }
+        // the fee is not accounted for in the buy or sell split,
+        // determine its USD value and spend the fee coin
+        fee_usd = fee_split.amount_ * Price(date, fee_split.coin_);
+        std::string memo = txn->Description() + " (" +
+                           fee_split.account_->FullName() + ")";
+        Push(fee_split.coin_->Id(),
+            TaxEvent(date, fee_split.amount_, fee_usd,
+                EventType::SpentTransactionFee, memo));
+      }
+    }
 
-          // there should be one split left now, which is an expense split, but
-          // not transaction, trading, or mining fee
-          if (splits.size() != 1) {
-            txn->Print(true);
-            throw std::runtime_error(
-                "Expected 1 split left in conversion spending");
-          }
+    // if the fee was paid in a 3rd coin (fee_usd > 0), account for the
+    // fee in the basis (i.e. cost) of the coin that was bought
+    std::string memo = txn->Description() + " (" +
+                       expense_split.account_->FullName() + ")";
+    Push(expense_split.coin_->Id(),
+        TaxEvent(date, expense_split.amount_, amt_usd + fee_usd,
+            EventType::SpentGeneral, memo));
+    Push(wallet_split.coin_->Id(), TaxEvent(
+        date, -wallet_split.amount_, amt_usd, EventType::TradeSell));
+
+    // done with this transaction
+    return;
+  }  // conversion spending transaction
+
+  // this has to be a trade transaction on an exchange
+  {
+    // All splits must either be under exchanges or trading fees, there is
+    // at most one trading fee split. There is one coin that is sold and one
+    // that is bought, and optionally, a different coin in which the fee is
+    // paid.
+
+    // first find fee
+    bool has_fee = false;
+    TaxSplit fee_split;
+    if (auto fee = TakeFirst(TradingFee)) {
+      fee_split = *fee;
+      has_fee = true;
+    }
 
-          // check the expense split
-          std::shared_ptr<const ProtoSplit> expense_split = nullptr;
-          it = splits.begin();
-          while (it != splits.end()) {
-            if ((*it)->account_->IsContainedIn(expenses) &&
-                !(*it)->account_->IsContainedIn(expense_transaction_fees) &&
-                !(*it)->account_->IsContainedIn(expense_mining_fees) &&
-                !(*it)->account_->IsContainedIn(expense_trading_fees) &&
-                ((*it)->amount_ > 0)) {
-              expense_split = *it;
-              it = splits.erase(it);
-              break;
-            }
-            ++it;
-          }
+    if (has_fee && (fee_split.amount_ <= 0)) {
+      throw TransactionError(txn, "Expect a positive trading fee");
+    }
 
-          if ((expense_split == nullptr) || (wallet_split == nullptr) ||
-              (splits.size() > 0)) {
-            txn->Print(true);
-            throw std::runtime_error("Couldn't get buy and sell splits");
-          }
+    // find fee match split and make sure all splits are in the exchange
+    // account
+    bool has_fee_match = false;
+    auto it = splits_.begin();
+    while (it != splits_.end()) {
+      if (!it->Is(Exchange)) {
+        throw TransactionError(
+            txn, "Expected exchange split in trade transaction");
+      }
+      if (has_fee) {
+        if ((it->coin_->Id() == fee_split.coin_->Id()) &&
+            (it->amount_ == -fee_split.amount_)) {
+          has_fee_match = true;
+          it = splits_.erase(it);
+          continue;
+        }
+      }
+      ++it;
+    }
 
-          auto date = txn->Date();
-          Amount fee_usd = 0;
-
-          // get the USD amount from the sell split by default
-          Amount amt_usd = -wallet_split->amount_ *
-                           file.GetHistoricUSDPrice(date, wallet_split->coin_);
-
-          // unless the buy coin is USD or USDT
-          if (expense_split->coin_->IsUSD())
-            amt_usd = expense_split->amount_;
-          else if (expense_split->coin_->Id() == "tether")
-            amt_usd = expense_split->amount_ *
-                      file.GetHistoricUSDPrice(date, expense_split->coin_);
-
-          if (fee_split != nullptr) {
-            if ((fee_split->coin_->Id() == expense_split->coin_->Id()) ||
-                (fee_split->coin_->Id() == wallet_split->coin_->Id())) {
-              // make sure we don't have a fee match, don't need to treat the
-              // fee separately, since it's already accounted for in the buy or
-              // sell split
-              if (fee_match_split != nullptr) {
-                txn->Print(true);
-                throw std::runtime_error("Unexpected fee match split");
-              }
-            } else {
-              // make sure we have a fee match
-              if (fee_match_split == nullptr) {
-                txn->Print(true);
-                throw std::runtime_error("Expected fee match split");
-              }
-              // the fee is not accounted for in the buy or sell split,
-              // determine its USD value and spend the fee coin
-              fee_usd = fee_split->amount_ *
-                        file.GetHistoricUSDPrice(date, fee_split->coin_);
-              std::string memo = txn->Description() + " (" +
-                                 fee_split->account_->FullName() + ")";
-              events_[fee_split->coin_->Id()].push_back(
-                  TaxEvent(date, fee_split->amount_, fee_usd,
-                      EventType::SpentTransactionFee, memo));
-            }
-          }
+    if (splits_.size() != 2) {
+      throw TransactionError(txn, "Expected 2 splits for a trade transaction");
+    }
 
-          // if the fee was paid in a 3rd coin (fee_usd > 0), account for the
-          // fee in the basis (i.e. cost) of the coin that was bought
-          std::string memo = txn->Description() + " (" +
-                             expense_split->account_->FullName() + ")";
-          events_[expense_split->coin_->Id()].push_back(
-              TaxEvent(date, expense_split->amount_, amt_usd + fee_usd,
-                  EventType::SpentGeneral, memo));
-          events_[wallet_split->coin_->Id()].push_back(TaxEvent(
-              date, -wallet_split->amount_, amt_usd, EventType::TradeSell));
-
-          // done with this transaction
-          continue;
+    // find buy and sell splits_
+    if ((splits_[0].amount_ == 0) || (splits_[1].amount_ == 0) ||
+        ((splits_[0].amount_ < 0) == (splits_[1].amount_ < 0))) {
+      throw TransactionError(txn, "Couldn't get buy and sell splits");
+    }
+    auto& buy_split = splits_[0].amount_ > 0 ? splits_[0] : splits_[1];
+    auto& sell_split = splits_[0].amount_ < 0 ? splits_[0] : splits_[1];
+
+    auto date = txn->Date();
+    Amount fee_usd = 0;
+
+    // get the USD amount from the sell split by default
+    Amount amt_usd = -sell_split.amount_ * Price(date, sell_split.coin_);
+
+    // unless the buy coin is USD or USDT
+    if (buy_split.coin_->IsUSD())
+      amt_usd = buy_split.amount_;
+    else if (buy_split.coin_->Id() == "tether")
+      amt_usd = buy_split.amount_ * Price(date, buy_split.coin_);
+
+    if (has_fee) {
+      if ((fee_split.coin_->Id() == buy_split.coin_->Id()) ||
+          (fee_split.coin_->Id() == sell_split.coin_->Id())) {
+        // make sure we don't have a fee match, don't need to treat the fee
+        // separately, since it's already accounted for in the buy or sell
+        // split
+        if (has_fee_match) {
+          throw TransactionError(txn, "Unexpected fee match split");
         }
-      }  // conversion spending transaction
-
-      // this has to be a trade transaction on an exchange
-      {
-        // All splits must either be under exchanges or trading fees, there is
-        // at most one trading fee split. There is one coin that is sold and one
-        // that is bought, and optionally, a different coin in which the fee is
-        // paid.
-
-        // first find fee
-        std::shared_ptr<const ProtoSplit> fee_split = nullptr;
-        auto it = splits.begin();
-        while (it != splits.end()) {
-          if ((*it)->account_->IsContainedIn(expense_trading_fees)) {
-            fee_split = *it;
-            it = splits.erase(it);
-            break;
-          }
-          ++it;
+      } else {
+        // make sure we have a fee match
+        if (!has_fee_match) {
+          throw TransactionError(txn, "Expected fee match split");
         }
+        // the fee is not accounted for in the buy or sell split, determine
+        // its USD value and spend the fee coin
+        fee_usd = fee_split.amount_ * Price(date, fee_split.coin_);
+        Push(fee_split.coin_->Id(), TaxEvent(
+            date, fee_split.amount_, fee_usd, EventType::SpentTradingFee));
+      }
+    }
 
-        if ((fee_split != nullptr) && (fee_split->amount_ <= 0)) {
-          txn->Print(true);
-          throw std::runtime_error("Expect a positive trading fee");
-        }
+    // if the fee was paid in a 3rd coin (fee_usd > 0), account for the fee
+    // in the basis (i.e. cost) of the coin that was bought
+    Push(buy_split.coin_->Id(), TaxEvent(
+        date, buy_split.amount_, amt_usd + fee_usd, EventType::TradeBuy));
+    Push(sell_split.coin_->Id(), TaxEvent(
+        date, -sell_split.amount_, amt_usd, EventType::TradeSell));
 
-        // find fee match split and make sure all splits are in the exchange
-        // account
-        std::shared_ptr<const ProtoSplit> fee_match_split = nullptr;
-        it = splits.begin();
-        while (it != splits.end()) {
-          if (!(*it)->account_->IsContainedIn(exchanges)) {
-            txn->Print(true);
-            throw std::runtime_error(
-                "Expected exchange split in trade transaction");
-          }
-          if (fee_split != nullptr) {
-            if (((*it)->coin_->Id() == fee_split->coin_->Id()) &&
-                ((*it)->amount_ == -fee_split->amount_)) {
-              fee_match_split = *it;
-              it = splits.erase(it);
-              continue;
-            }
-          }
-          ++it;
-        }
+    // done with this transaction
+    return;
+  }  // trade transaction
+}
 
-        if (splits.size() != 2) {
-          txn->Print(true);
-          throw std::runtime_error("Expected 2 splits for a trade transaction");
+// match the disposals among the events of one coin from begin to end against
+// the acquisitions in inventory and return the realized gains and losses in the
+// order of the disposals, the lot of an acquisition is identified by the import
+// id of its transaction and specific_lots names the lots a disposal consumes
+// first; the wash sales start with the dispositions in carryover, which are not
+// returned with the gains, and afterwards carryover has the dispositions that
+// carry over to carryover_date
+std::vector<GainLoss> MatchLots(const File& file, const std::string& coin_id,
+    std::vector<TaxEvent>::const_iterator begin,
+    std::vector<TaxEvent>::const_iterator end, bool adjust_for_wash_sale,
+    const Taxes::SpecificLots& specific_lots, Inventory* inventory,
+    std::vector<GainLoss>* carryover, Datetime carryover_date) {
+  std::vector<GainLoss> gains(*carryover);
+  size_t num_carried = gains.size();
+  WashSales wash_sales(&gains);
+  const std::vector<std::string> no_lots;
+
+  for (auto itm = begin; itm != end; ++itm) {
+    auto& e = *itm;
+    if ((e.type == EventType::MiningIncome) ||
+        (e.type == EventType::OtherIncome) ||
+        (e.type == EventType::TradeIncome) ||
+        (e.type == EventType::TradeBuy)) {
+      // check for wash sale
+      Amount wash_sale(0);
+      if (adjust_for_wash_sale)
+        wash_sale = wash_sales.Acquire(e.date, e.amount);
+
+      InventoryItem new_inv(
+          e.date, e.amount, e.amount_usd + wash_sale, e.import_id);
+      inventory->Acquire(new_inv);
+    } else if ((e.type == EventType::SpentGeneral) ||
+               (e.type == EventType::SpentTransactionFee) ||
+               (e.type == EventType::SpentTradingFee) ||
+               (e.type == EventType::TradeSell)) {
+      auto lots = specific_lots.find(e.import_id);
+      auto disp = inventory->Dispose(
+          e.amount, lots == specific_lots.end() ? no_lots : lots->second);
+
+      if (disp.size() == 0) {
+        throw std::runtime_error("Got 0 disposals");
+      } else if (disp.size() == 1) {
+        // only one inventory item was consumed
+        auto d = disp[0];
+        if (d.amount != e.amount) throw std::runtime_error("Amount mismatch");
+        gains.push_back(GainLoss(file.GetCoin(coin_id), e.amount, d.date,
+            e.date, e.amount_usd, d.cost_in_usd));
+      } else {
+        for (auto& d : disp) {
+          Amount this_proceed = (e.amount_usd * d.amount) / e.amount;
+          gains.push_back(GainLoss(file.GetCoin(coin_id), d.amount, d.date,
+              e.date, this_proceed, d.cost_in_usd));
         }
+      }
+    }
+  }
 
-        // find buy and sell splits
-        std::shared_ptr<const ProtoSplit> buy_split = nullptr;
-        std::shared_ptr<const ProtoSplit> sell_split = nullptr;
-        it = splits.begin();
-        while (it != splits.end()) {
-          if ((*it)->amount_ < 0) {
-            sell_split = *it;
-            it = splits.erase(it);
-            continue;
-          }
-          if ((*it)->amount_ > 0) {
-            buy_split = *it;
-            it = splits.erase(it);
-            continue;
-          }
-          ++it;
-        }
+  if (adjust_for_wash_sale)
+    *carryover = wash_sales.Carryover(carryover_date);
+  else
+    carryover->clear();
 
-        if ((buy_split == nullptr) || (sell_split == nullptr) ||
-            (splits.size() > 0)) {
-          txn->Print(true);
-          throw std::runtime_error("Couldn't get buy and sell splits");
-        }
+  gains.erase(gains.begin(), gains.begin() + num_carried);
+  return gains;
+}
 
-        auto date = txn->Date();
-        Amount fee_usd = 0;
-
-        // get the USD amount from the sell split by default
-        Amount amt_usd = -sell_split->amount_ *
-                         file.GetHistoricUSDPrice(date, sell_split->coin_);
-
-        // unless the buy coin is USD or USDT
-        if (buy_split->coin_->IsUSD())
-          amt_usd = buy_split->amount_;
-        else if (buy_split->coin_->Id() == "tether")
-          amt_usd = buy_split->amount_ *
-                    file.GetHistoricUSDPrice(date, buy_split->coin_);
-
-        if (fee_split != nullptr) {
-          if ((fee_split->coin_->Id() == buy_split->coin_->Id()) ||
-              (fee_split->coin_->Id() == sell_split->coin_->Id())) {
-            // make sure we don't have a fee match, don't need to treat the fee
-            // separately, since it's already accounted for in the buy or sell
-            // split
-            if (fee_match_split != nullptr) {
-              txn->Print(true);
-              throw std::runtime_error("Unexpected fee match split");
-            }
-          } else {
-            // make sure we have a fee match
-            if (fee_match_split == nullptr) {
-              txn->Print(true);
-              throw std::runtime_error("Expected fee match split");
-            }
-            // the fee is not accounted for in the buy or sell split, determine
-            // its USD value and spend the fee coin
-            fee_usd = fee_split->amount_ *
-                      file.GetHistoricUSDPrice(date, fee_split->coin_);
-            events_[fee_split->coin_->Id()].push_back(TaxEvent(
-                date, fee_split->amount_, fee_usd, EventType::SpentTradingFee));
-          }
-        }
+// fetch the days from the first to the last missing day of each coin and then
+// look up the missing prices, which applies the fallbacks of DailyData for days
+// without data (e.g. today)
+void FetchPrices(const File& file,
+    const std::map<PriceKey, std::shared_ptr<const Coin>>& missing,
+    size_t num_threads, std::map<PriceKey, Amount>* fetched) {
+  // the missing prices are sorted by coin and then by day
+  std::vector<std::shared_ptr<const Coin>> coins;
+  std::vector<std::pair<int64_t, int64_t>> days;
+  for (auto& it : missing) {
+    int64_t day = it.first.second;
+    if ((coins.size() == 0) || (coins.back()->Id() != it.first.first)) {
+      coins.push_back(it.second);
+      days.push_back({day, day});
+    } else {
+      days.back().second = day;
+    }
+  }
 
-        // if the fee was paid in a 3rd coin (fee_usd > 0), account for the fee
-        // in the basis (i.e. cost) of the coin that was bought
-        events_[buy_split->coin_->Id()].push_back(TaxEvent(
-            date, buy_split->amount_, amt_usd + fee_usd, EventType::TradeBuy));
-        events_[sell_split->coin_->Id()].push_back(TaxEvent(
-            date, -sell_split->amount_, amt_usd, EventType::TradeSell));
+  printf("Missing %zu daily prices of %zu coins, fetching them...\n",
+      missing.size(), coins.size());
+  file.PrefetchUSDPrices(
+      coins, days, std::min(NumThreads(num_threads), max_fetch_threads));
 
-        // done with this transaction
+  for (auto& it : missing) {
+    auto date = Datetime::FromUNIXTimestamp(it.first.second * 24 * 3600);
+    fetched->insert({it.first, file.GetHistoricUSDPrice(date, it.second)});
+  }
+}
+
+// a disposal is long-term if the lot was held for more than the given days
+bool IsLongTerm(const GainLoss& g, size_t long_term_in_days) {
+  size_t holding_period_in_seconds = g.acquired.AbsDiffInSeconds(g.disposed);
+  return holding_period_in_seconds > (long_term_in_days * 24 * 3600);
+}
+
+const char* LotMethodName(LotMethod method) {
+  static const char* names[] = {
+      "FIFO", "LIFO", "HIFO", "Specific ID", "Average Cost"};
+  return names[(int)method];
+}
+
+}  // namespace
+
+Taxes::Taxes(const File& file, Datetime until, Accnts assets, Accnts wallets,
+    Accnts ecr20_account, Accnts exchanges, Accnts equity, Accnts expenses,
+    Accnts expense_mining_fees, Accnts expense_trading_fees,
+    Accnts expense_transaction_fees, Accnts income_other, Accnts income_mining,
+    Accnts income_trade, const std::vector<std::string>& ignore_txns,
+    size_t num_threads, Datetime since) {
+  // auto liabilities = file.GetAccount("Liabilities");
+
+  std::unordered_set<std::string> ignore;
+  for (const auto& s : ignore_txns) ignore.insert(s);
+
+  // look up the roles of the accounts once instead of calling IsContainedIn
+  // for every split
+  auto roles = MakeRoleTable(file, {{Asset, &assets}, {Wallet, &wallets},
+      {ECR20, &ecr20_account}, {Exchange, &exchanges}, {Equity, &equity},
+      {Expense, &expenses}, {MiningFee, &expense_mining_fees},
+      {TradingFee, &expense_trading_fees},
+      {TransactionFee, &expense_transaction_fees},
+      {OtherIncome, &income_other}, {MiningIncome, &income_mining},
+      {TradeIncome, &income_trade}});
+
+  try {
+    // only transactions from since up to until are relevant, so we walk the
+    // date index from since and stop at until
+    std::vector<std::shared_ptr<const Transaction>> txns;
+    auto& by_date = file.TransactionsByDate();
+    auto last = by_date.upper_bound(until);
+    auto first = (since <= until) ? by_date.lower_bound(since) : last;
+    for (auto itm = first; itm != last; ++itm) {
+      auto txn = itm->second;
+      if ((ignore.size() > 0) && (ignore.count(txn->Import_id()) > 0))
         continue;
-      }  // trade transaction
+      txns.push_back(txn);
+    }
+
+    // extract the events of each chunk of transactions in its own thread, a
+    // chunk stops at its first error and the error is kept so that we can
+    // report the same error as if the transactions were processed serially
+    std::map<PriceKey, Amount> fetched;
+    std::vector<EventExtractor> extractors;
+    std::vector<std::exception_ptr> errors;
+    size_t num_chunks = 0;
+    auto extract = [&]() {
+      extractors = std::vector<EventExtractor>(
+          NumThreads(num_threads), EventExtractor(file, roles, &fetched));
+      errors.assign(extractors.size(), nullptr);
+      num_chunks = ParallelChunks(txns.size(), num_threads,
+          [&](size_t chunk, size_t begin, size_t end) {
+            try {
+              for (size_t i = begin; i < end; ++i)
+                extractors[chunk].Add(txns[i]);
+            } catch (...) {
+              errors[chunk] = std::current_exception();
+            }
+          });
+
+      // the chunks after the first error don't matter
+      std::map<PriceKey, std::shared_ptr<const Coin>> missing;
+      for (size_t c = 0; c < num_chunks; ++c) {
+        missing.insert(
+            extractors[c].missing_.begin(), extractors[c].missing_.end());
+        if (errors[c]) break;
+      }
+      return missing;
+    };
+
+    // the first extraction finds the prices that are needed but not in memory,
+    // if there are any, they are fetched all at once before the events are
+    // extracted again
+    auto missing = extract();
+    if (missing.size() > 0) {
+      FetchPrices(file, missing, num_threads, &fetched);
+      if (extract().size() > 0)
+        throw std::runtime_error("Prices are still missing after fetching");
+    }
+
+    // append the events of the chunks in chunk order and stop at the first
+    // error, the mining income of a day may be split over several chunks
+    std::unordered_map<std::string, std::map<Datetime, TaxEvent>> mining;
+    for (size_t c = 0; c < num_chunks; ++c) {
+      for (auto& it : extractors[c].events_) {
+        auto& events = events_[it.first];
+        events.insert(events.end(), it.second.begin(), it.second.end());
+      }
+
+      if (errors[c]) std::rethrow_exception(errors[c]);
 
-      // if we end up here, we couldn't handle this transaction
-      txn->Print(true);
-      throw std::runtime_error("Don't know how to handle that transaction");
+      for (auto& it : extractors[c].mining_) {
+        auto& days = mining[it.first];
+        for (auto& itm : it.second) {
+          auto day = days.find(itm.first);
+          if (day == days.end()) {
+            days.insert(itm);
+          } else {
+            day->second.amount += itm.second.amount;
+            day->second.amount_usd += itm.second.amount_usd;
+          }
+        }
+      }
     }
 
     // add mining events
@@ -652,12 +884,23 @@ Taxes::Taxes(const File& file, Datetime until, Accnt assets, Accnt wallets,
       }
     }
 
-    // sort events by time
-    for (auto& it : events_) {
-      std::sort(it.second.begin(), it.second.end(),
-          [](const TaxEvent& a, const TaxEvent& b) { return a.date < b.date; });
-    }
+    // sort events by time, the sort is stable so that events with the same
+    // time stay in transaction order, the coins are sorted in parallel
+    std::vector<std::vector<TaxEvent>*> coin_events;
+    for (auto& it : events_) coin_events.push_back(&it.second);
+    ParallelChunks(coin_events.size(), num_threads,
+        [&](size_t /*chunk*/, size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            std::stable_sort(coin_events[i]->begin(), coin_events[i]->end(),
+                [](const TaxEvent& a, const TaxEvent& b) {
+                  return a.date < b.date;
+                });
+          }
+        });
 
+  } catch (TransactionError& ex) {
+    ex.Txn()->Print(true);
+    printf("ERROR ocurred while constructing taxes: %s\n", ex.what());
   } catch (std::exception& ex) {
     printf("ERROR ocurred while constructing taxes: %s\n", ex.what());
   }
@@ -730,118 +973,52 @@ void Taxes::PrintSpending(const File& file, Datetime from) const {
 }
 
 void Taxes::PrintCapitalGainsLosses(const File& file, size_t long_term_in_days,
-    bool LIFO, Datetime from, bool adjust_for_wash_sale, bool fuse) const {
-  std::vector<GainLoss> short_term;
-  std::vector<GainLoss> long_term;
-
-  std::map<std::string, Inventory> inventories;
+    LotMethod method, Datetime from, bool adjust_for_wash_sale, bool fuse,
+    size_t num_threads, const SpecificLots& specific_lots) const {
+  PrintCapitalGainsLosses(file, long_term_in_days,
+      TaxCheckpoint(Datetime::Earliest(), method, adjust_for_wash_sale), from,
+      fuse, num_threads, specific_lots);
+}
 
-  for (auto& it : events_) {
-    auto coin_id = it.first;
-    if (coin_id == Coin::USD_id()) {
-      for (auto& e : it.second) {
-        if (e.amount != e.amount_usd)
-          throw std::runtime_error("Got USD event with mismatching amounts");
-      }
-      continue;
-    }
-
-    inventories.insert({{coin_id, Inventory(LIFO)}});
-    std::vector<GainLoss> gains;
-
-    for (auto& e : it.second) {
-      if ((e.type == EventType::MiningIncome) ||
-          (e.type == EventType::OtherIncome) ||
-          (e.type == EventType::TradeIncome) ||
-          (e.type == EventType::TradeBuy)) {
-        // check for wash sale
-        Amount wash_sale(0);
-        if (adjust_for_wash_sale) {
-          Amount remain = e.amount;
-
-          // sort gains chronologically
-          std::sort(gains.begin(), gains.end(),
-              [](const GainLoss& a, const GainLoss& b) {
-                return a.disposed < b.disposed;
-              });
-
-          for (auto itr = gains.rbegin(); itr != gains.rend(); ++itr) {
-            size_t diff_in_seconds = e.date.AbsDiffInSeconds(itr->disposed);
-            if (diff_in_seconds <= 30 * 24 * 3600) {
-              // we have a potential wash sale
-              Amount loss = itr->cost - itr->proceeds - itr->wash_sale_loss;
-              if ((loss > 0) && (itr->unwashed_amount > 0)) {
-                // actual wash sale
-                auto washed_amount = std::min(remain, itr->unwashed_amount);
-
-                Amount new_wash_sale =
-                    (loss * washed_amount) / itr->unwashed_amount;
-
-                itr->wash_sale_loss += new_wash_sale;
-                wash_sale += new_wash_sale;
-
-                itr->unwashed_amount -= washed_amount;
-                remain -= washed_amount;
-              }
-            } else {
-              // no wash sale and other acquisitions were even earlier
-              break;
-            }
+void Taxes::PrintCapitalGainsLosses(const File& file, size_t long_term_in_days,
+    const TaxCheckpoint& checkpoint, bool fuse, size_t num_threads,
+    const SpecificLots& specific_lots) const {
+  PrintCapitalGainsLosses(file, long_term_in_days, checkpoint,
+      checkpoint.Date(), fuse, num_threads, specific_lots);
+}
 
-            if (remain == 0) break;  // we're done
-          }
-        }
+void Taxes::PrintCapitalGainsLosses(const File& file, size_t long_term_in_days,
+    const TaxCheckpoint& checkpoint, Datetime from, bool fuse,
+    size_t num_threads, const SpecificLots& specific_lots) const {
+  std::vector<GainLoss> short_term;
+  std::vector<GainLoss> long_term;
 
-        InventoryItem new_inv(e.date, e.amount, e.amount_usd + wash_sale);
-        inventories.at(coin_id).Acquire(new_inv);
-      } else if ((e.type == EventType::SpentGeneral) ||
-                 (e.type == EventType::SpentTransactionFee) ||
-                 (e.type == EventType::SpentTradingFee) ||
-                 (e.type == EventType::TradeSell)) {
-        auto disp = inventories.at(coin_id).Dispose(e.amount);
-
-        if (disp.size() == 0) {
-          throw std::runtime_error("Got 0 disposals");
-        } else if (disp.size() == 1) {
-          // only one inventory item was consumed
-          auto d = disp[0];
-          if (d.amount != e.amount) throw std::runtime_error("Amount mismatch");
-          gains.push_back(GainLoss(file.GetCoin(coin_id), e.amount, d.date,
-              e.date, e.amount_usd, d.cost_in_usd));
-        } else {
-          for (auto& d : disp) {
-            Amount this_proceed = (e.amount_usd * d.amount) / e.amount;
-            gains.push_back(GainLoss(file.GetCoin(coin_id), d.amount, d.date,
-                e.date, this_proceed, d.cost_in_usd));
-          }
-        }
-      }
-    }
+  TaxCheckpoint end(
+      Datetime::Now(), checkpoint.Method(), checkpoint.AdjustForWashSale());
+  auto gains = MatchLotsFrom(
+      file, checkpoint, nullptr, num_threads, specific_lots, &end);
 
-    for (auto& g : gains) {
-      size_t holding_period_in_seconds =
-          g.acquired.AbsDiffInSeconds(g.disposed);
-      if (holding_period_in_seconds > (long_term_in_days * 24 * 3600))
-        long_term.push_back(g);
-      else
-        short_term.push_back(g);
-    }
+  for (auto& g : gains) {
+    if (IsLongTerm(g, long_term_in_days))
+      long_term.push_back(g);
+    else
+      short_term.push_back(g);
   }
 
   printf("Short-Term Disposition of Assets\n");
   printf("================================\n");
-  PrintGainLoss(&short_term, fuse, from);
+  PrintGainLoss(short_term, fuse, from);
   printf("\n\n");
 
   printf("Long-Term Disposition of Assets\n");
   printf("===============================\n");
-  PrintGainLoss(&long_term, fuse, from);
+  PrintGainLoss(long_term, fuse, from);
   printf("\n\n");
 
   auto prices = PriceSource::GetUSDPrices();
 
   std::map<std::string, UnsoldInventory> unsold;
-  for (auto& it : inventories) {
+  for (auto& it : end.inventories_) {
     unsold.insert({it.first, it.second.Unsold(long_term_in_days)});
   }
 
@@ -852,68 +1029,440 @@ void Taxes::PrintCapitalGainsLosses(const File& file, size_t long_term_in_days,
   PrintUnrealizedGainLoss(unsold, UnsoldType::Total, prices, file);
 }
 
+TaxCheckpoint Taxes::MakeCheckpoint(const File& file, Datetime date,
+    LotMethod method, bool adjust_for_wash_sale, size_t num_threads,
+    const SpecificLots& specific_lots) const {
+  return MakeCheckpoint(file, date,
+      TaxCheckpoint(Datetime::Earliest(), method, adjust_for_wash_sale),
+      num_threads, specific_lots);
+}
+
+TaxCheckpoint Taxes::MakeCheckpoint(const File& file, Datetime date,
+    const TaxCheckpoint& start, size_t num_threads,
+    const SpecificLots& specific_lots) const {
+  // the mining income of a day is one event at the end of the day, so a
+  // checkpoint in the middle of a day would split that event
+  if (date.AbsDiffInSeconds(date.EndOfDay()) != 24 * 3600 - 1)
+    throw std::invalid_argument(
+        "Checkpoint " + date.ToStrUTC() + " is not the start of a day");
+  if (date < start.Date())
+    throw std::invalid_argument("Checkpoint " + date.ToStrUTC() +
+                                " is before the start checkpoint " +
+                                start.Date().ToStrUTC());
+
+  TaxCheckpoint end(date, start.Method(), start.AdjustForWashSale());
+  MatchLotsFrom(file, start, &date, num_threads, specific_lots, &end);
+  return end;
+}
+
+std::vector<UnrealizedAsOf> Taxes::GetUnrealizedAsOf(const File& file,
+    size_t long_term_in_days, LotMethod method, bool adjust_for_wash_sale,
+    const std::vector<Datetime>& dates, size_t num_threads,
+    const SpecificLots& specific_lots) const {
+  // the lots are matched in date order up to the start of the day after each
+  // date
+  std::vector<size_t> order(dates.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+      [&](size_t a, size_t b) { return dates[a] < dates[b]; });
+
+  std::vector<Datetime> next_days;
+  for (size_t i : order) {
+    next_days.push_back(Datetime::FromUNIXTimestamp(
+        (dates[i].DailyDataDay() + 1) * 24 * 3600));
+  }
+
+  std::vector<std::string> coin_ids;
+  for (auto& it : events_) {
+    if (it.first != Coin::USD_id()) coin_ids.push_back(it.first);
+  }
+
+  // the coins are independent of each other, so the lots of each coin are
+  // matched in a separate task, which takes the unsold lots at each date and
+  // then continues with the events of the next date
+  auto by_date = [](const TaxEvent& e, Datetime d) { return e.date < d; };
+  std::vector<std::vector<UnsoldInventory>> coin_unsold(coin_ids.size());
+  std::vector<std::exception_ptr> errors(coin_ids.size());
+  ParallelFor(coin_ids.size(), num_threads, [&](size_t c) {
+    try {
+      auto& events = events_.at(coin_ids[c]);
+      Inventory inventory(method);
+      std::vector<GainLoss> carryover;
+
+      auto begin = events.begin();
+      for (size_t d = 0; d < order.size(); ++d) {
+        auto end =
+            std::lower_bound(begin, events.end(), next_days[d], by_date);
+        MatchLots(file, coin_ids[c], begin, end, adjust_for_wash_sale,
+            specific_lots, &inventory, &carryover, next_days[d]);
+        coin_unsold[c].push_back(inventory.Unsold(
+            long_term_in_days, dates[order[d]].EndOfDay()));
+        begin = end;
+      }
+    } catch (...) {
+      errors[c] = std::current_exception();
+    }
+  });
+
+  for (auto& e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+
+  std::vector<UnrealizedAsOf> res;
+  for (auto& d : dates) res.push_back(UnrealizedAsOf(d));
+
+  std::map<PriceKey, std::shared_ptr<const Coin>> missing;
+  for (size_t d = 0; d < order.size(); ++d) {
+    auto& r = res[order[d]];
+    for (size_t c = 0; c < coin_ids.size(); ++c) {
+      if (coin_unsold[c][d].total.amount == 0) continue;
+      r.unsold.insert({coin_ids[c], coin_unsold[c][d]});
+
+      auto coin = file.GetCoin(coin_ids[c]);
+      Amount price;
+      if (file.FindHistoricUSDPrice(r.date, coin, &price))
+        r.prices[coin_ids[c]] = price;
+      else
+        missing.insert({{coin_ids[c], r.date.DailyDataDay()}, coin});
+    }
+  }
+
+  if (missing.size() > 0) {
+    std::map<PriceKey, Amount> fetched;
+    FetchPrices(file, missing, num_threads, &fetched);
+
+    for (auto& r : res) {
+      for (auto& it : r.unsold) {
+        if (r.prices.count(it.first) == 0)
+          r.prices[it.first] = fetched.at({it.first, r.date.DailyDataDay()});
+      }
+    }
+  }
+
+  return res;
+}
+
+void Taxes::PrintUnrealizedGainsLosses(const File& file,
+    size_t long_term_in_days, LotMethod method, bool adjust_for_wash_sale,
+    const std::vector<Datetime>& dates, size_t num_threads,
+    const SpecificLots& specific_lots) const {
+  auto res = GetUnrealizedAsOf(file, long_term_in_days, method,
+      adjust_for_wash_sale, dates, num_threads, specific_lots);
+
+  for (auto& r : res) {
+    printf("End of %s\n", r.date.ToStrDayUTC().c_str());
+    printf("=================\n\n");
+
+    PrintUnrealizedGainLoss(r.unsold, UnsoldType::ShortTerm, r.prices, file);
+    printf("\n\n");
+    PrintUnrealizedGainLoss(r.unsold, UnsoldType::LongTerm, r.prices, file);
+    printf("\n\n");
+    PrintUnrealizedGainLoss(r.unsold, UnsoldType::Total, r.prices, file);
+    printf("\n\n");
+  }
+}
+
+std::vector<TaxScenarioTotals> Taxes::GetScenarioTotals(const File& file,
+    const std::vector<TaxScenario>& scenarios,
+    const std::unordered_map<std::string, Amount>& prices, Datetime from,
+    size_t num_threads, const SpecificLots& specific_lots) const {
+  // the lots are matched once for each method and wash sale setting
+  std::map<std::pair<LotMethod, bool>, size_t> matchings;
+  std::vector<TaxCheckpoint> starts, ends;
+  for (auto& sc : scenarios) {
+    auto key = std::make_pair(sc.method, sc.adjust_for_wash_sale);
+    if (matchings.insert({key, starts.size()}).second) {
+      starts.push_back(TaxCheckpoint(
+          Datetime::Earliest(), sc.method, sc.adjust_for_wash_sale));
+      ends.push_back(
+          TaxCheckpoint(Datetime::Now(), sc.method, sc.adjust_for_wash_sale));
+    }
+  }
+
+  std::vector<const TaxCheckpoint*> start_ptrs;
+  std::vector<TaxCheckpoint*> end_ptrs;
+  for (size_t m = 0; m < starts.size(); ++m) {
+    start_ptrs.push_back(&starts[m]);
+    end_ptrs.push_back(&ends[m]);
+  }
+  auto gains = MatchLotsFrom(
+      file, start_ptrs, nullptr, num_threads, specific_lots, end_ptrs);
+
+  std::vector<TaxScenarioTotals> totals;
+  for (auto& sc : scenarios) {
+    size_t m = matchings.at({sc.method, sc.adjust_for_wash_sale});
+    TaxScenarioTotals t(sc);
+
+    for (auto& g : gains[m]) {
+      if (g.disposed < from) continue;
+      Amount profit = g.proceeds - g.cost + g.wash_sale_loss;
+      (IsLongTerm(g, sc.long_term_in_days) ? t.long_term : t.short_term) +=
+          profit;
+      t.wash_sale_loss += g.wash_sale_loss;
+    }
+
+    for (auto& it : ends[m].inventories_) {
+      auto unsold = it.second.Unsold(sc.long_term_in_days);
+      if (unsold.total.amount == 0) continue;
+      auto price = prices.at(it.first);
+      t.unrealized_short_term +=
+          unsold.short_term.amount * price - unsold.short_term.cost_in_usd;
+      t.unrealized_long_term +=
+          unsold.long_term.amount * price - unsold.long_term.cost_in_usd;
+    }
+
+    totals.push_back(t);
+  }
+
+  return totals;
+}
+
+void Taxes::PrintScenarios(const File& file,
+    const std::vector<TaxScenario>& scenarios, Datetime from,
+    size_t num_threads, const SpecificLots& specific_lots) const {
+  auto totals = GetScenarioTotals(file, scenarios, PriceSource::GetUSDPrices(),
+      from, num_threads, specific_lots);
+
+  printf("Tax Scenarios\n");
+  printf("=============\n");
+
+  printf("%30s", "");
+  for (auto& t : totals) printf("  %28s", LotMethodName(t.scenario.method));
+  printf("\n%30s", "");
+  for (auto& t : totals) {
+    printf("  %28s",
+        t.scenario.adjust_for_wash_sale ? "wash sales" : "no wash sales");
+  }
+  printf("\n%30s", "");
+  for (auto& t : totals) {
+    auto days = std::to_string(t.scenario.long_term_in_days) + " days";
+    printf("  %28s", days.c_str());
+  }
+  printf("\n\n");
+
+  using Get = std::function<Amount(const TaxScenarioTotals&)>;
+  auto print_row = [&](const char* name, Get get) {
+    printf("%30s", name);
+    for (auto& t : totals) printf("  %28s", get(t).ToStr().c_str());
+    printf("\n");
+  };
+
+  print_row("Short-Term Profit/Loss (USD)",
+      [](const TaxScenarioTotals& t) { return t.short_term; });
+  print_row("Long-Term Profit/Loss (USD)",
+      [](const TaxScenarioTotals& t) { return t.long_term; });
+  print_row("Total Profit/Loss (USD)",
+      [](const TaxScenarioTotals& t) { return t.short_term + t.long_term; });
+  print_row("Wash Sale Loss (USD)",
+      [](const TaxScenarioTotals& t) { return t.wash_sale_loss; });
+  printf("\n");
+  print_row("Unrealized Short-Term (USD)",
+      [](const TaxScenarioTotals& t) { return t.unrealized_short_term; });
+  print_row("Unrealized Long-Term (USD)",
+      [](const TaxScenarioTotals& t) { return t.unrealized_long_term; });
+  print_row("Unrealized Total (USD)", [](const TaxScenarioTotals& t) {
+    return t.unrealized_short_term + t.unrealized_long_term;
+  });
+}
+
+bool Taxes::ValidateCheckpoint(const File& file,
+    const TaxCheckpoint& checkpoint, size_t num_threads,
+    const SpecificLots& specific_lots) const {
+  auto recomputed = MakeCheckpoint(file, checkpoint.Date(),
+      checkpoint.Method(), checkpoint.AdjustForWashSale(), num_threads,
+      specific_lots);
+
+  auto diffs = checkpoint.Differences(recomputed);
+  for (auto& d : diffs) printf("Checkpoint differs: %s\n", d.c_str());
+
+  return diffs.size() == 0;
+}
+
+std::vector<std::vector<GainLoss>> Taxes::MatchLotsFrom(const File& file,
+    const std::vector<const TaxCheckpoint*>& starts, const Datetime* until,
+    size_t num_threads, const SpecificLots& specific_lots,
+    const std::vector<TaxCheckpoint*>& ends) const {
+  // the coins are independent of each other and so are the starts, so the lots
+  // of each start and coin are matched in a separate task and the gains of the
+  // tasks are combined in coin order afterwards, a coin of a checkpoint may not
+  // have new events
+  using EventIter = std::vector<TaxEvent>::const_iterator;
+  struct CoinTask {
+    size_t start;
+    std::string coin_id;
+    EventIter begin, end;
+    Inventory* inventory;
+    std::vector<GainLoss>* carryover;
+  };
+
+  static const std::vector<TaxEvent> no_events;
+  auto by_date = [](const TaxEvent& e, Datetime d) { return e.date < d; };
+
+  std::vector<CoinTask> tasks;
+  for (size_t s = 0; s < starts.size(); ++s) {
+    auto& start = *starts[s];
+    auto end = ends[s];
+    end->inventories_ = start.inventories_;
+    end->carryover_ = start.carryover_;
+
+    std::map<std::string, std::pair<EventIter, EventIter>> ranges;
+    for (auto& it : events_) {
+      auto begin = std::lower_bound(
+          it.second.begin(), it.second.end(), start.Date(), by_date);
+      auto last = (until == nullptr) ? it.second.end()
+                                     : std::lower_bound(it.second.begin(),
+                                           it.second.end(), *until, by_date);
+      ranges.insert({it.first, {begin, last}});
+    }
+    for (auto& it : start.inventories_) {
+      if (ranges.count(it.first) == 0)
+        ranges.insert({it.first, {no_events.begin(), no_events.end()}});
+    }
+
+    for (auto& it : ranges) {
+      CoinTask task{
+          s, it.first, it.second.first, it.second.second, nullptr, nullptr};
+      if (it.first != Coin::USD_id()) {
+        auto inv =
+            end->inventories_.insert({it.first, Inventory(start.Method())});
+        task.inventory = &inv.first->second;
+        task.carryover = &end->carryover_[it.first];
+      }
+      tasks.push_back(task);
+    }
+  }
+
+  // start with the coins that have the most events, so that a big coin doesn't
+  // keep one thread busy after all others are done
+  auto num_events = [&](size_t t) { return tasks[t].end - tasks[t].begin; };
+  std::vector<size_t> order(tasks.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+      [&](size_t a, size_t b) { return num_events(a) > num_events(b); });
+
+  // if several coins have errors, report the error of the first coin of the
+  // first start
+  std::vector<std::vector<GainLoss>> task_gains(tasks.size());
+  std::vector<std::exception_ptr> errors(tasks.size());
+  ParallelFor(order.size(), num_threads, [&](size_t i) {
+    auto& task = tasks[order[i]];
+    try {
+      if (task.coin_id == Coin::USD_id()) {
+        for (auto e = task.begin; e != task.end; ++e) {
+          if (e->amount != e->amount_usd)
+            throw std::runtime_error("Got USD event with mismatching amounts");
+        }
+      } else {
+        task_gains[order[i]] = MatchLots(file, task.coin_id, task.begin,
+            task.end, starts[task.start]->AdjustForWashSale(), specific_lots,
+            task.inventory, task.carryover, ends[task.start]->Date());
+      }
+    } catch (...) {
+      errors[order[i]] = std::current_exception();
+    }
+  });
+
+  for (auto& e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+
+  // drop the coins without anything to carry over, so that a checkpoint only
+  // has the coins that matter
+  for (auto end : ends) {
+    for (auto itm = end->carryover_.begin(); itm != end->carryover_.end();) {
+      if (itm->second.size() == 0)
+        itm = end->carryover_.erase(itm);
+      else
+        ++itm;
+    }
+  }
+
+  std::vector<std::vector<GainLoss>> gains(starts.size());
+  for (size_t t = 0; t < tasks.size(); ++t) {
+    auto& g = gains[tasks[t].start];
+    g.insert(g.end(), task_gains[t].begin(), task_gains[t].end());
+  }
+  return gains;
+}
+
 void Taxes::PrintGainLoss(
-    std::vector<GainLoss>* gains, bool fuse, Datetime from) const {
+    const std::vector<GainLoss>& gains, bool fuse, Datetime from) const {
   printf("%34s  %10s  %10s  %28s  %28s  %28s  %28s\n", "Description",
       "Acquired", "Disposed", "Net Proceeds (USD)", "Net Cost (USD)",
       "Wash Sale Loss (USD)", "Profit/Loss (USD)");
 
   Amount total_profit(0);
 
-  if (gains->size() == 0) return;
-
-  std::sort(
-      gains->begin(), gains->end(), [](const GainLoss& a, const GainLoss& b) {
-        if (a.coin->Id() == b.coin->Id()) {
-          if (a.disposed == b.disposed) {
-            return a.acquired < b.acquired;
-          } else {
-            return a.disposed < b.disposed;
-          }
-        } else {
-          return a.coin->Id() < b.coin->Id();
-        }
-      });
+  // rank the coins by id once, so that the gains can be grouped and sorted by
+  // integers instead of comparing the ids over and over
+  std::unordered_map<const Coin*, size_t> coin_ranks;
+  {
+    std::vector<const Coin*> coins;
+    for (auto& g : gains) {
+      if (coin_ranks.insert({g.coin.get(), 0}).second)
+        coins.push_back(g.coin.get());
+    }
+    std::sort(coins.begin(), coins.end(),
+        [](const Coin* a, const Coin* b) { return a->Id() < b->Id(); });
+
+    // different coin objects with the same id get the same rank
+    size_t rank = 0;
+    for (size_t i = 0; i < coins.size(); ++i) {
+      if ((i > 0) && (coins[i]->Id() != coins[i - 1]->Id())) ++rank;
+      coin_ranks[coins[i]] = rank;
+    }
+  }
 
   std::vector<GainLoss> fused;
-  std::vector<GainLoss>* fused_ptr;
-
+  std::vector<size_t> ranks;
   if (fuse) {
-    fused_ptr = &fused;
-    fused.push_back((*gains)[0]);
-
-    for (size_t i = 1; i < gains->size(); ++i) {
-      auto& g = (*gains)[i];
-      auto& prev = fused[fused.size() - 1];
-
-      // we can fuse this gain with the previous one if they have the same
-      // coin and were disposed on the same day
-      if ((prev.coin->Id() == g.coin->Id()) &&
-          (prev.disposed.EndOfDay() == g.disposed.EndOfDay())) {
-        prev.amount += g.amount;
-        prev.proceeds += g.proceeds;
-        prev.cost += g.cost;
-        prev.wash_sale_loss += g.wash_sale_loss;
-        if (prev.acquired != g.acquired) prev.various_acquired_dates = true;
-      } else {
+    // we fuse all gains that have the same coin and were disposed on the same
+    // day, a fused gain keeps the earliest disposal (and of those the earliest
+    // acquisition) of its gains and has various acquired dates if its gains
+    // don't all have the same acquired date
+    std::unordered_map<uint64_t, size_t> groups;
+    groups.reserve(gains.size());
+    for (auto& g : gains) {
+      size_t rank = coin_ranks.at(g.coin.get());
+      uint64_t key = ((uint64_t)rank << 32) | g.disposed.DailyDataDay();
+
+      auto group = groups.insert({key, fused.size()});
+      if (group.second) {
         fused.push_back(g);
+        ranks.push_back(rank);
+        continue;
+      }
+
+      auto& f = fused[group.first->second];
+      f.amount += g.amount;
+      f.proceeds += g.proceeds;
+      f.cost += g.cost;
+      f.wash_sale_loss += g.wash_sale_loss;
+      if (f.acquired != g.acquired) f.various_acquired_dates = true;
+      if ((g.disposed < f.disposed) ||
+          ((g.disposed == f.disposed) && (g.acquired < f.acquired))) {
+        f.disposed = g.disposed;
+        f.acquired = g.acquired;
       }
     }
   } else {
-    fused_ptr = gains;
+    for (auto& g : gains) ranks.push_back(coin_ranks.at(g.coin.get()));
   }
 
-  // now sort again this time by disposed date first
-  std::sort(fused_ptr->begin(), fused_ptr->end(),
-      [](const GainLoss& a, const GainLoss& b) {
-        if (a.disposed == b.disposed) {
-          return a.coin->Id() < b.coin->Id();
-        } else {
-          return a.disposed < b.disposed;
-        }
-      });
-
-  for (auto& g : *fused_ptr) {
+  // the report is sorted by disposed date and then by coin, gains of the same
+  // disposal are sorted by acquired date
+  auto& rows = fuse ? fused : gains;
+  std::vector<size_t> order(rows.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (rows[a].disposed != rows[b].disposed)
+      return rows[a].disposed < rows[b].disposed;
+    if (ranks[a] != ranks[b]) return ranks[a] < ranks[b];
+    return rows[a].acquired < rows[b].acquired;
+  });
+
+  for (size_t i : order) {
+    auto& g = rows[i];
     if (g.disposed < from) continue;
 
     Amount profit = g.proceeds - g.cost + g.wash_sale_loss;
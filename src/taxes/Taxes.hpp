@@ -2,6 +2,7 @@
 #define SRC_TAXES_TAXES_HPP_
 
 #include <map>
+#include <unordered_map>
 
 #include "Account.hpp"
 #include "Amount.hpp"
@@ -10,6 +11,8 @@
 #include "File.hpp"
 #include "taxes/Inventory.hpp"
 
+class TaxCheckpoint;
+
 enum class EventType {
   MiningIncome,
   OtherIncome,
@@ -38,6 +41,10 @@ struct TaxEvent {
   Amount amount_usd;
   EventType type;
   std::string memo;
+
+  // the import id of the transaction of this event, empty for the mining
+  // income of a day, which combines several transactions
+  std::string import_id;
 };
 
 struct GainLoss {
@@ -67,9 +74,58 @@ struct GainLoss {
   Amount unwashed_amount;
 };
 
+// a way to compute the capital gains and losses, to compare several of them
+// with Taxes::GetScenarioTotals
+struct TaxScenario {
+  TaxScenario(
+      LotMethod method, bool adjust_for_wash_sale, size_t long_term_in_days)
+      : method(method),
+        adjust_for_wash_sale(adjust_for_wash_sale),
+        long_term_in_days(long_term_in_days) {}
+
+  LotMethod method;
+  bool adjust_for_wash_sale;
+  size_t long_term_in_days;
+};
+
+// the realized and unrealized profit/loss of a scenario
+struct TaxScenarioTotals {
+  TaxScenarioTotals(const TaxScenario& scenario)
+      : scenario(scenario),
+        short_term(0),
+        long_term(0),
+        wash_sale_loss(0),
+        unrealized_short_term(0),
+        unrealized_long_term(0) {}
+
+  TaxScenario scenario;
+
+  // the realized profit/loss including the wash sale losses, which are also
+  // given on their own
+  Amount short_term, long_term;
+  Amount wash_sale_loss;
+
+  Amount unrealized_short_term, unrealized_long_term;
+};
+
+// the unsold lots of all coins at the end of the day of date, valued at the
+// daily prices of that day
+struct UnrealizedAsOf {
+  UnrealizedAsOf(Datetime date) : date(date) {}
+
+  Datetime date;
+
+  // by coin id, only the coins with unsold lots
+  std::map<std::string, UnsoldInventory> unsold;
+  std::unordered_map<std::string, Amount> prices;
+};
+
 class Taxes {
  public:
   using Accnt = std::shared_ptr<const Account>;
+  // several accounts with the same role, e.g. the same account in several
+  // files of a FederatedFile
+  using Accnts = std::vector<Accnt>;
 
   // To compute taxable events up to a certain point, all the transactions prior
   // that that point have to be known. That's why this class only takes an until
@@ -80,7 +136,27 @@ class Taxes {
       Accnt ecr20_account, Accnt exchanges, Accnt equity, Accnt expenses,
       Accnt expense_mining_fees, Accnt expense_trading_fees,
       Accnt expense_transaction_fees, Accnt income_other, Accnt income_mining,
-      Accnt income_trade, const std::vector<std::string>& ignore_txns);
+      Accnt income_trade, const std::vector<std::string>& ignore_txns,
+      size_t num_threads = 0, Datetime since = Datetime::Earliest())
+      : Taxes(file, until, Accnts{assets}, Accnts{wallets},
+            Accnts{ecr20_account}, Accnts{exchanges}, Accnts{equity},
+            Accnts{expenses}, Accnts{expense_mining_fees},
+            Accnts{expense_trading_fees}, Accnts{expense_transaction_fees},
+            Accnts{income_other}, Accnts{income_mining}, Accnts{income_trade},
+            ignore_txns, num_threads, since) {}
+
+  // a split has a role if its account is contained in any of the accounts
+  // given for that role, the transactions are processed in up to num_threads
+  // threads (0 means one thread per core) and the events are the same for any
+  // number of threads, only the transactions since the given datetime are
+  // processed, which is the date of a checkpoint to continue from
+  Taxes(const File& file, Datetime until, Accnts assets, Accnts wallets,
+      Accnts ecr20_account, Accnts exchanges, Accnts equity, Accnts expenses,
+      Accnts expense_mining_fees, Accnts expense_trading_fees,
+      Accnts expense_transaction_fees, Accnts income_other,
+      Accnts income_mining, Accnts income_trade,
+      const std::vector<std::string>& ignore_txns, size_t num_threads = 0,
+      Datetime since = Datetime::Earliest());
 
   // print events after from datetime
   void PrintEvents(const File& file, EventType type, Datetime from) const;
@@ -95,18 +171,130 @@ class Taxes {
     PrintSpending(file, Datetime::Earliest());
   }
 
+  // the import ids of the transactions whose lots a disposal consumes first
+  // with LotMethod::SpecificID, by the import id of the disposing transaction
+  using SpecificLots = std::map<std::string, std::vector<std::string>>;
+
+  // method selects the lots that are consumed by a disposal, the lots of the
+  // coins are matched in up to num_threads threads (0 means one thread per
+  // core)
   void PrintCapitalGainsLosses(const File& file, size_t long_term_in_days,
-      bool LIFO, Datetime from, bool adjust_for_wash_sale,
-      bool fuse = true) const;
+      LotMethod method, Datetime from, bool adjust_for_wash_sale,
+      bool fuse = true, size_t num_threads = 0,
+      const SpecificLots& specific_lots = SpecificLots()) const;
   void PrintCapitalGainsLosses(const File& file, size_t long_term_in_days,
-      bool LIFO, bool adjust_for_wash_sale, bool fuse = true) const {
+      LotMethod method, bool adjust_for_wash_sale, bool fuse = true,
+      size_t num_threads = 0,
+      const SpecificLots& specific_lots = SpecificLots()) const {
+    PrintCapitalGainsLosses(file, long_term_in_days, method,
+        Datetime::Earliest(), adjust_for_wash_sale, fuse, num_threads,
+        specific_lots);
+  }
+
+  void PrintCapitalGainsLosses(const File& file, size_t long_term_in_days,
+      bool LIFO, Datetime from, bool adjust_for_wash_sale, bool fuse = true,
+      size_t num_threads = 0) const {
+    PrintCapitalGainsLosses(file, long_term_in_days,
+        LIFO ? LotMethod::LIFO : LotMethod::FIFO, from, adjust_for_wash_sale,
+        fuse, num_threads);
+  }
+  void PrintCapitalGainsLosses(const File& file, size_t long_term_in_days,
+      bool LIFO, bool adjust_for_wash_sale, bool fuse = true,
+      size_t num_threads = 0) const {
     PrintCapitalGainsLosses(file, long_term_in_days, LIFO, Datetime::Earliest(),
-        adjust_for_wash_sale, fuse);
+        adjust_for_wash_sale, fuse, num_threads);
+  }
+
+  // continue from the lots and wash sales of a checkpoint with its method, only
+  // the events since the checkpoint are used, so this Taxes may have been
+  // constructed with the checkpoint date as since
+  void PrintCapitalGainsLosses(const File& file, size_t long_term_in_days,
+      const TaxCheckpoint& checkpoint, Datetime from, bool fuse = true,
+      size_t num_threads = 0,
+      const SpecificLots& specific_lots = SpecificLots()) const;
+  void PrintCapitalGainsLosses(const File& file, size_t long_term_in_days,
+      const TaxCheckpoint& checkpoint, bool fuse = true, size_t num_threads = 0,
+      const SpecificLots& specific_lots = SpecificLots()) const;
+
+  // get the open lots and the wash sale carryover of all coins after the
+  // events before date, which must be the start of a UTC day (e.g. the first
+  // day of a year) and not after the until of this Taxes, the lots are matched
+  // from the first event or from the start checkpoint
+  TaxCheckpoint MakeCheckpoint(const File& file, Datetime date,
+      LotMethod method, bool adjust_for_wash_sale, size_t num_threads = 0,
+      const SpecificLots& specific_lots = SpecificLots()) const;
+  TaxCheckpoint MakeCheckpoint(const File& file, Datetime date,
+      const TaxCheckpoint& start, size_t num_threads = 0,
+      const SpecificLots& specific_lots = SpecificLots()) const;
+
+  // get the unsold lots at the end of the day of each date, the lots are
+  // matched once for all dates and the unsold lots are valued at the historic
+  // daily prices, which are only fetched if they are not in the file yet, the
+  // results are in the order of the dates, which should not be after the until
+  // of this Taxes
+  std::vector<UnrealizedAsOf> GetUnrealizedAsOf(const File& file,
+      size_t long_term_in_days, LotMethod method, bool adjust_for_wash_sale,
+      const std::vector<Datetime>& dates, size_t num_threads = 0,
+      const SpecificLots& specific_lots = SpecificLots()) const;
+
+  // print the unrealized gains and losses at the end of the day of each date,
+  // e.g. at the end of every month of a year
+  void PrintUnrealizedGainsLosses(const File& file, size_t long_term_in_days,
+      LotMethod method, bool adjust_for_wash_sale,
+      const std::vector<Datetime>& dates, size_t num_threads = 0,
+      const SpecificLots& specific_lots = SpecificLots()) const;
+
+  // match the lots of all scenarios at the same time, each scenario with its
+  // own inventories, scenarios that only differ in the holding period share
+  // the matching, the realized totals are of the disposals after from and the
+  // unsold lots are valued at prices, the totals are in scenario order
+  std::vector<TaxScenarioTotals> GetScenarioTotals(const File& file,
+      const std::vector<TaxScenario>& scenarios,
+      const std::unordered_map<std::string, Amount>& prices, Datetime from,
+      size_t num_threads = 0,
+      const SpecificLots& specific_lots = SpecificLots()) const;
+
+  // print the totals of the scenarios side by side, the unsold lots are valued
+  // at the current prices
+  void PrintScenarios(const File& file,
+      const std::vector<TaxScenario>& scenarios, Datetime from,
+      size_t num_threads = 0,
+      const SpecificLots& specific_lots = SpecificLots()) const;
+  void PrintScenarios(const File& file,
+      const std::vector<TaxScenario>& scenarios, size_t num_threads = 0,
+      const SpecificLots& specific_lots = SpecificLots()) const {
+    PrintScenarios(file, scenarios, Datetime::Earliest(), num_threads,
+        specific_lots);
   }
 
+  // recompute the checkpoint from the first event and print how the given
+  // checkpoint differs, e.g. because transactions before the checkpoint have
+  // been changed since it was made, return true if there are no differences
+  bool ValidateCheckpoint(const File& file, const TaxCheckpoint& checkpoint,
+      size_t num_threads = 0,
+      const SpecificLots& specific_lots = SpecificLots()) const;
+
  private:
+  // match the lots of the events from each start checkpoint on (and before
+  // until if it is given) starting from its lots and wash sales, the lots of
+  // all starts and coins are matched at the same time, the gains of each start
+  // are returned in coin order and the state after the events is put in the
+  // end with the same index
+  std::vector<std::vector<GainLoss>> MatchLotsFrom(const File& file,
+      const std::vector<const TaxCheckpoint*>& starts, const Datetime* until,
+      size_t num_threads, const SpecificLots& specific_lots,
+      const std::vector<TaxCheckpoint*>& ends) const;
+  std::vector<GainLoss> MatchLotsFrom(const File& file,
+      const TaxCheckpoint& start, const Datetime* until, size_t num_threads,
+      const SpecificLots& specific_lots, TaxCheckpoint* end) const {
+    return MatchLotsFrom(
+        file, {&start}, until, num_threads, specific_lots, {end})[0];
+  }
+
+  // print the gains sorted by disposed date, with fuse the gains of the same
+  // coin that were disposed on the same day are printed as one
   void PrintGainLoss(
-      std::vector<GainLoss>* gains, bool fuse, Datetime from) const;
+      const std::vector<GainLoss>& gains, bool fuse, Datetime from) const;
 
   enum class UnsoldType { LongTerm, ShortTerm, Total };
   void PrintUnrealizedGainLoss(
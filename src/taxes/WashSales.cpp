@@ -0,0 +1,64 @@
+#include "WashSales.hpp"
+
+#include <algorithm>
+
+namespace {
+
+const size_t window_in_seconds = 30 * 24 * 3600;
+
+}  // namespace
+
+Amount WashSales::Acquire(Datetime date, Amount amount) {
+  auto& gains = *gains_;
+
+  // pick up the dispositions made since the last acquisition, a disposition
+  // that is not washable now can never become washable
+  for (; num_seen_ < gains.size(); ++num_seen_) {
+    if (Washable(gains[num_seen_])) washable_.push_back(num_seen_);
+  }
+
+  // later acquisitions are even further away from these dispositions
+  while ((washable_.size() > 0) &&
+         (date.AbsDiffInSeconds(gains[washable_.front()].disposed) >
+             window_in_seconds))
+    washable_.pop_front();
+
+  Amount wash_sale(0);
+  Amount remain = amount;
+  if (remain == 0) return wash_sale;
+
+  // wash the most recent dispositions first
+  while (washable_.size() > 0) {
+    auto& g = gains[washable_.back()];
+    auto washed_amount = std::min(remain, g.unwashed_amount);
+
+    Amount new_wash_sale = (Loss(g) * washed_amount) / g.unwashed_amount;
+
+    g.wash_sale_loss += new_wash_sale;
+    wash_sale += new_wash_sale;
+
+    g.unwashed_amount -= washed_amount;
+    remain -= washed_amount;
+
+    if (!Washable(g)) washable_.pop_back();
+    if (remain == 0) break;  // we're done
+  }
+
+  return wash_sale;
+}
+
+std::vector<GainLoss> WashSales::Carryover(Datetime date) const {
+  auto& gains = *gains_;
+  std::vector<GainLoss> res;
+
+  auto add = [&](size_t i) {
+    if (Washable(gains[i]) &&
+        (date.AbsDiffInSeconds(gains[i].disposed) <= window_in_seconds))
+      res.push_back(gains[i]);
+  };
+
+  for (size_t i : washable_) add(i);
+  for (size_t i = num_seen_; i < gains.size(); ++i) add(i);
+
+  return res;
+}
@@ -0,0 +1,54 @@
+#ifndef SRC_TAXES_WASHSALES_HPP_
+#define SRC_TAXES_WASHSALES_HPP_
+
+#include <deque>
+#include <vector>
+
+#include "Amount.hpp"
+#include "Datetime.hpp"
+#include "taxes/Taxes.hpp"
+
+// Finds the wash sales of one coin: a loss from a disposition is disallowed if
+// the same coin is acquired within 30 days of the disposition, and the
+// disallowed loss is added to the cost basis of the acquisition. The
+// dispositions are appended to gains by the caller and both dispositions and
+// acquisitions must come in chronological order, like the events of a coin.
+//
+// Only dispositions in the last 30 days that still have an unwashed loss can be
+// washed, and those are kept in disposal order. Dispositions that fall out of
+// the window are dropped at the front and since an acquisition washes the most
+// recent dispositions first, the ones it washes completely are dropped at the
+// back, so every disposition is only looked at a few times.
+class WashSales {
+ public:
+  explicit WashSales(std::vector<GainLoss>* gains)
+      : gains_(gains), num_seen_(0) {}
+
+  // wash the losses of the dispositions within 30 days before date with the
+  // given acquired amount and return the disallowed loss
+  Amount Acquire(Datetime date, Amount amount);
+
+  // get the dispositions that can still be washed by an acquisition at or
+  // after date, in disposal order, these carry over to a checkpoint at date
+  std::vector<GainLoss> Carryover(Datetime date) const;
+
+ private:
+  static Amount Loss(const GainLoss& g) {
+    return g.cost - g.proceeds - g.wash_sale_loss;
+  }
+
+  static bool Washable(const GainLoss& g) {
+    return (Loss(g) > 0) && (g.unwashed_amount > 0);
+  }
+
+  std::vector<GainLoss>* gains_;
+
+  // the number of dispositions in gains_ that have been checked for losses
+  size_t num_seen_;
+
+  // the indices of the washable dispositions in gains_ that are not older than
+  // 30 days before the last acquisition, oldest first
+  std::deque<size_t> washable_;
+};
+
+#endif  // SRC_TAXES_WASHSALES_HPP_